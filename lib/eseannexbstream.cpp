@@ -16,6 +16,7 @@
  */
 
 #include "eseannexbstream.h"
+#include "eseframe.h"
 #include "eselogger.h"
 #include "esereader.h"
 
@@ -64,25 +65,81 @@ getUleb128 (const uint8_t *in, uint32_t *num_bytes)
   return (uint32_t)val;
 }
 
+bool
+ESEAnnexBStream::seek (uint64_t number)
+{
+  ESEBuffer buffer;
+
+  if (!m_index || number >= m_index->size ())
+    return false;
+  // The stream is read in one buffer, which is kept if it starts the stream.
+  uint64_t offset = m_index->entry (number).offset;
+  buffer.swap (m_buffer);
+  if (m_reader->position () != static_cast<int64_t> (buffer.size ())) {
+    if (!m_reader->seek (0)) {
+      m_buffer.swap (buffer);
+      return false;
+    }
+    buffer = m_reader->getBuffer (5 * 1024 * 1024);
+  }
+  // Skip the temporal units preceding the frame, then the frames of its unit.
+  size_t pos = 0;
+  while (pos < buffer.size ()) {
+    uint32_t ulebSize = 0;
+    uint32_t size     = getUleb128 (buffer.data () + pos, &ulebSize);
+    size_t   frame    = pos + ulebSize;
+    size_t   end      = frame + size;
+    if (!ulebSize || end > buffer.size ())
+      break;
+    pos = end;
+    if (offset >= end)
+      continue;
+    while (frame < end) {
+      ulebSize           = 0;
+      uint32_t frameSize = getUleb128 (buffer.data () + frame, &ulebSize);
+      if (!ulebSize)
+        break;
+      if (frame + ulebSize == offset) {
+        prepareSeek (number);
+        m_buffer.swap (buffer);
+        m_bufferPosition               = frame;
+        m_inTemporalUnit               = true;
+        m_remainingBytesInTemporalUnit = end - frame;
+        return true;
+      }
+      frame += ulebSize + frameSize;
+    }
+    break;
+  }
+  m_buffer.swap (buffer);
+  ERR ("Unable to find the frame %" PRIu64 " at offset %" PRIu64, number, offset);
+  return false;
+}
+
 ESEResult
 ESEAnnexBStream::processToNextFrame ()
 {
   ESEResult res = ESE_RESULT_NEW_PACKET;
   m_codec       = ESE_VIDEO_CODEC_AV1;
 
-  if (m_bufferPosition >= (uint32_t)m_buffer.size ())
+  if (m_bufferPosition >= m_buffer.size ()) {
+    // The temporal units are parsed from a single buffer, so a pushed
+    // stream is only parsed once complete.
+    if (m_reader->isLive ())
+      return ESE_RESULT_NO_PACKET;
     // HACK: The API is racey, work around that for CTS
     // requirements. No bitstream will be bigger that 5MiB.
     m_buffer = m_reader->getBuffer (5 * 1024 * 1024);
+  }
 
-  if (m_nextPacket)
+  if (m_packetReady)
     return res;
 
   if (m_eos)
     return ESE_RESULT_EOS;
 
   const uint8_t *ptr = m_buffer.data () + m_bufferPosition;
-  DBG ("ptr offset %ld %ld ", m_bufferPosition, m_buffer.size ());
+  DBG ("ptr offset %zd %zd ", m_bufferPosition, m_buffer.size ());
 
   if (!m_inTemporalUnit) {
     uint32_t tuUlebSize = 0;
@@ -97,13 +154,20 @@ ESEAnnexBStream::processToNextFrame ()
   uint32_t frameSize     = getUleb128 (ptr, &frameUlebSize);
 
   ptr += frameUlebSize;
-  uint32_t frameStartOffset = static_cast<uint32_t> (ptr - m_buffer.data ());
-  uint32_t frameEndOffset   = frameStartOffset + frameSize;
+  size_t frameStartOffset = static_cast<size_t> (ptr - m_buffer.data ());
+  size_t frameEndOffset   = frameStartOffset + frameSize;
   assert (frameEndOffset <= m_buffer.size ());
 
-  m_currentFrame = prepareFrame (m_buffer, frameStartOffset, frameEndOffset);
-
-  prepareNextPacket ();
+  // The buffer holds the stream up to the reader position.
+  uint64_t bufferOffset = static_cast<uint64_t> (m_reader->position ()) - m_buffer.size ();
+  bool     keyframe     = ese_av1_is_key_frame (ESEBufferView (m_buffer).subView (frameStartOffset, frameSize), true);
+  if (m_descriptorOnly) {
+    prepareEmptyPacket ();
+  } else {
+    prepareFrame (m_buffer, frameStartOffset, frameEndOffset, m_currentFrame);
+    prepareNextPacket (m_currentFrame);
+  }
+  indexPacket (bufferOffset + frameStartOffset, frameSize, 0, keyframe);
 
   m_remainingBytesInTemporalUnit -= (frameSize + frameUlebSize);
   if (m_remainingBytesInTemporalUnit == 0) {
@@ -117,8 +181,8 @@ ESEAnnexBStream::processToNextFrame ()
     return ESE_RESULT_LAST_PACKET;
   }
 
-  DBG ("Found a new Annex B frame (%d) of size %zd at offset %ld", m_frameCount,
-    m_currentFrame.size (), frameStartOffset);
+  DBG ("Found a new Annex B frame (%" PRIu64 ") of size %zd at offset %zd", m_frameCount,
+    m_packetInfo.data_size, frameStartOffset);
 
   return ESE_RESULT_NEW_PACKET;
 }
@@ -126,6 +190,6 @@ ESEAnnexBStream::processToNextFrame ()
 void
 ESEAnnexBStream::parseOptions (const char *options)
 {
-  (void)options;
   INFO ("Create a AnnexB stream");
+  ESEStream::parseOptions (options);
 }
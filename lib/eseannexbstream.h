@@ -29,6 +29,7 @@ class ESEAnnexBStream : public ESEStream {
 
   virtual void parseOptions (const char *options) override;
   virtual void reset () override;
+  virtual bool seek (uint64_t number) override;
 
   ESEResult processToNextFrame () override;
 
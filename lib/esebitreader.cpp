@@ -0,0 +1,98 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "esebitreader.h"
+
+ESEBitReader::ESEBitReader (ESEBufferView data)
+: m_data (data)
+, m_pos (0)
+, m_byte (0)
+, m_bitsLeft (0)
+, m_zeros (0)
+, m_exhausted (false)
+{
+}
+
+bool
+ESEBitReader::loadByte ()
+{
+  if (m_pos < m_data.size () && m_zeros >= 2 && m_data[m_pos] == 0x03) {
+    m_pos++;
+    m_zeros = 0;
+  }
+  if (m_pos >= m_data.size ()) {
+    m_exhausted = true;
+    return false;
+  }
+  m_byte     = m_data[m_pos++];
+  m_bitsLeft = 8;
+  m_zeros    = m_byte ? 0 : m_zeros + 1;
+  return true;
+}
+
+uint32_t
+ESEBitReader::readBits (unsigned count)
+{
+  uint32_t value = 0;
+
+  while (count) {
+    if (!m_bitsLeft && !loadByte ())
+      return 0;
+    unsigned bits = count < m_bitsLeft ? count : m_bitsLeft;
+    m_bitsLeft -= bits;
+    count -= bits;
+    value = static_cast<uint32_t> ((static_cast<uint64_t> (value) << bits) | ((m_byte >> m_bitsLeft) & ((1u << bits) - 1)));
+  }
+  return value;
+}
+
+uint32_t
+ESEBitReader::readUE ()
+{
+  unsigned leading_zeros = 0;
+
+  while (!readBits (1)) {
+    // A valid value holds at most 31 leading zero bits.
+    if (m_exhausted || ++leading_zeros > 31) {
+      m_exhausted = true;
+      return 0;
+    }
+  }
+  if (!leading_zeros)
+    return 0;
+  return static_cast<uint32_t> ((1ull << leading_zeros) - 1 + readBits (leading_zeros));
+}
+
+int32_t
+ESEBitReader::readSE ()
+{
+  uint32_t value = readUE ();
+  // 1, 2, 3, 4 map to 1, -1, 2, -2.
+  if (value & 1)
+    return static_cast<int32_t> ((value >> 1) + 1);
+  return -static_cast<int32_t> (value >> 1);
+}
+
+void
+ESEBitReader::skipBits (size_t count)
+{
+  while (count > 32) {
+    readBits (32);
+    count -= 32;
+  }
+  readBits (static_cast<unsigned> (count));
+}
@@ -0,0 +1,52 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include "eseutils.h"
+
+/// @brief Reads the bits of a NAL payload, the emulation prevention bytes
+/// removed. Reading past the end returns zero bits and marks the reader as
+/// exhausted.
+class ESEBitReader {
+  public:
+  /// @brief Reads data, starting after the NAL header.
+  ESEBitReader (ESEBufferView data);
+
+  /// @brief Reads count bits, up to 32, the first one being the most significant.
+  uint32_t readBits (unsigned count);
+  bool     readFlag () { return readBits (1) != 0; }
+  /// @brief Reads an unsigned Exp-Golomb value, ue(v).
+  uint32_t readUE ();
+  /// @brief Reads a signed Exp-Golomb value, se(v).
+  int32_t  readSE ();
+  void     skipBits (size_t count);
+  /// @brief Returns false once the reader read past the end of the data.
+  bool     isValid () { return !m_exhausted; }
+
+  private:
+  bool loadByte ();
+
+  ESEBufferView m_data;
+  size_t        m_pos;
+  // Current byte and number of its bits left to read.
+  uint8_t       m_byte;
+  unsigned      m_bitsLeft;
+  // Zero bytes preceding m_pos, an emulation prevention byte follows two.
+  unsigned      m_zeros;
+  bool          m_exhausted;
+};
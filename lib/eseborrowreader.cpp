@@ -0,0 +1,133 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+
+#include <cstring>
+
+#include "eseborrowreader.h"
+
+ESEBorrowReader::ESEBorrowReader (ese_borrow_buffer_func borrow_func, ese_release_buffer_func release_func, void *pointer)
+: m_borrowFunc (borrow_func)
+, m_releaseFunc (release_func)
+, m_dataPointer (pointer)
+, m_block (nullptr)
+, m_blockSize (0)
+, m_blockOffset (0)
+, m_eos (false)
+{
+}
+
+ESEBorrowReader::~ESEBorrowReader ()
+{
+  release ();
+}
+
+void
+ESEBorrowReader::reset ()
+{
+  release ();
+  m_eos = false;
+  ESEReader::reset ();
+}
+
+bool
+ESEBorrowReader::seek (int64_t position)
+{
+  // The block borrowed last is kept, it may hold the position.
+  m_eos = false;
+  return ESEReader::seek (position);
+}
+
+size_t
+ESEBorrowReader::readAt (uint8_t *data, size_t size, int64_t pos)
+{
+  // The end of the stream is only reached by the stream reads, the payloads
+  // are still borrowed once they have reached it.
+  bool   eos       = m_eos;
+  m_eos            = false;
+  size_t read_size = readChunk (data, size, pos);
+  m_eos            = eos;
+  return read_size;
+}
+
+void
+ESEBorrowReader::release ()
+{
+  if (m_block && m_releaseFunc)
+    m_releaseFunc (m_dataPointer, m_block);
+  m_block     = nullptr;
+  m_blockSize = 0;
+}
+
+size_t
+ESEBorrowReader::borrow (int64_t pos)
+{
+  if (m_block && pos >= m_blockOffset && pos < m_blockOffset + static_cast<int64_t> (m_blockSize))
+    return m_blockSize - static_cast<size_t> (pos - m_blockOffset);
+
+  release ();
+  if (m_eos)
+    return 0;
+  // The application provides as many contiguous bytes as it has from pos.
+  const unsigned char *block = nullptr;
+  size_t               size  = m_borrowFunc (m_dataPointer, &block, bufferReadLength (), pos);
+  DBG ("Borrow %zd bytes at pos %" PRId64, size, pos);
+  if (!size || !block) {
+    if (block && m_releaseFunc)
+      m_releaseFunc (m_dataPointer, block);
+    m_eos = true;
+    return 0;
+  }
+  m_block       = block;
+  m_blockSize   = size;
+  m_blockOffset = pos;
+  return size;
+}
+
+size_t
+ESEBorrowReader::appendBuffer (ESEBuffer &buffer, size_t size)
+{
+  size_t read_size = 0;
+  size_t available;
+
+  // Single copy from the borrowed blocks to the buffer.
+  while (read_size < size && (available = borrow (m_streamPosition))) {
+    const uint8_t *data = m_block + (m_streamPosition - m_blockOffset);
+    if (available > size - read_size)
+      available = size - read_size;
+    buffer.insert (buffer.end (), data, data + available);
+    read_size += available;
+    m_streamPosition += static_cast<int64_t> (available);
+  }
+  m_readSize = static_cast<size_t> (m_streamPosition);
+  return read_size;
+}
+
+size_t
+ESEBorrowReader::readChunk (uint8_t *data, size_t size, int64_t pos)
+{
+  size_t read_size = 0;
+  size_t available;
+
+  while (read_size < size && (available = borrow (pos + static_cast<int64_t> (read_size)))) {
+    if (available > size - read_size)
+      available = size - read_size;
+    std::memcpy (data + read_size, m_block + (pos + static_cast<int64_t> (read_size) - m_blockOffset), available);
+    read_size += available;
+  }
+  return read_size;
+}
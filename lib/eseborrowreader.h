@@ -0,0 +1,56 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include "esereader.h"
+#include "esextractor.h"
+
+/// @brief Reader borrowing the stream data from the application memory.
+/// The borrowed blocks are copied once to the returned buffers, and given
+/// back with the release callback when another block is needed or on reset.
+class ESEBorrowReader : public ESEReader {
+  public:
+  ESEBorrowReader (ese_borrow_buffer_func borrow_func, ese_release_buffer_func release_func, void *pointer);
+  ~ESEBorrowReader ();
+
+  virtual void reset ();
+  virtual bool prepare () { return true; }
+  virtual bool   seek (int64_t position);
+  virtual size_t readAt (uint8_t *data, size_t size, int64_t pos);
+
+  virtual size_t appendBuffer (ESEBuffer &buffer, size_t size);
+  virtual size_t    streamSize () { return 0; }
+  virtual bool      isEOS () { return m_eos; }
+
+  protected:
+  virtual size_t readChunk (uint8_t *data, size_t size, int64_t pos);
+
+  private:
+  /// @brief Borrows the block containing pos if needed.
+  /// @return the number of bytes available from pos in the block.
+  size_t borrow (int64_t pos);
+  void   release ();
+
+  ese_borrow_buffer_func  m_borrowFunc;
+  ese_release_buffer_func m_releaseFunc;
+  void                   *m_dataPointer;
+  const uint8_t          *m_block;
+  size_t                  m_blockSize;
+  int64_t                 m_blockOffset;
+  bool                    m_eos;
+};
@@ -17,8 +17,21 @@
 
 #include "esedatareader.h"
 
+#include <limits>
+
+ESEDataReader::ESEDataReader (ese_read_buffer_func64 read_func, void *pointer)
+{
+  m_readFunc64  = read_func;
+  m_readFunc    = nullptr;
+  m_dataPointer = pointer;
+  m_eos         = false;
+
+  reset ();
+}
+
 ESEDataReader::ESEDataReader (ese_read_buffer_func read_func, void *pointer)
 {
+  m_readFunc64  = nullptr;
   m_readFunc    = read_func;
   m_dataPointer = pointer;
   m_eos         = false;
@@ -33,56 +46,39 @@ ESEDataReader::prepare ()
   return true;
 }
 
-size_t
-ESEDataReader::readData (size_t size, int32_t position, bool append)
+bool
+ESEDataReader::seek (int64_t position)
 {
-  ESEBuffer buffer;
-  size_t    read_size;
-
-  buffer.resize (size);
-  m_streamPosition = position;
-
-  // Ask the app to provide data with size from a position in the stream. Can return less than expected.
-  read_size = m_readFunc (m_dataPointer, buffer.data (), size, m_streamPosition);
-  //
-  buffer.resize (read_size);
-  if (read_size == 0) {
-    m_eos = true;
-    return read_size;
-  }
-
-  m_readSize += read_size;
-  m_streamPosition += static_cast<int32_t> (read_size);
+  m_eos = false;
+  return ESEReader::seek (position);
+}
 
-  if (append) {
-    m_buffer.insert (m_buffer.end (), buffer.begin (), buffer.end ());
-    INFO ("ReadFile: Append to a buffer of new size %zd requested size %d read %zd", size,
-      m_buffer.size (), read_size);
-  } else {
-    m_buffer = buffer;
-    DBG ("ReadFile: Read buffer %d of size read %zd", size, read_size);
-  }
-  m_bufferSize = m_buffer.size ();
+size_t
+ESEDataReader::readAt (uint8_t *data, size_t size, int64_t pos)
+{
+  // The end of the stream is only reached by the stream reads.
+  bool   eos       = m_eos;
+  size_t read_size = readChunk (data, size, pos);
+  m_eos            = eos;
   return read_size;
 }
 
-ESEBuffer
-ESEDataReader::getBuffer (size_t size)
+size_t
+ESEDataReader::readChunk (uint8_t *data, size_t size, int64_t pos)
 {
-  size_t    real_size = size;
-  ESEBuffer buffer;
+  size_t read_size;
 
-  while (m_buffer.size () < size) {
-    if (readData (bufferReadLength (), m_streamPosition,
-          true)
-      < bufferReadLength ())
-      break;
+  // Ask the app to provide data with size from a position in the stream. Can return less than expected.
+  if (m_readFunc64) {
+    read_size = m_readFunc64 (m_dataPointer, data, size, pos);
+  } else if (pos <= std::numeric_limits<int32_t>::max ()) {
+    read_size = m_readFunc (m_dataPointer, data, size, static_cast<int32_t> (pos));
+  } else {
+    ERR ("The stream is larger than 2 GiB, use es_extractor_new_with_read_func64");
+    read_size = 0;
   }
-  if (m_buffer.size () < size)
-    real_size = m_buffer.size ();
-
-  buffer = subVector (m_buffer, 0, real_size);
-  m_buffer.erase (m_buffer.begin (), m_buffer.begin () + real_size);
-  m_bufferSize = m_buffer.size ();
-  return buffer;
+  if (read_size == 0)
+    m_eos = true;
+  DBG ("Read %zd of size %zd at pos %" PRId64, read_size, size, pos);
+  return read_size;
 }
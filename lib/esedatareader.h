@@ -23,18 +23,22 @@
 
 class ESEDataReader : public ESEReader {
   public:
+  ESEDataReader (ese_read_buffer_func64 read_func, void *pointer);
   ESEDataReader (ese_read_buffer_func read_func, void *pointer);
   ~ESEDataReader () { }
 
-  bool              prepare ();
-  virtual ESEBuffer getBuffer (size_t size);
-  virtual bool      isEOS () { return m_eos; }
-  virtual size_t    streamSize () { return 0; }
+  bool           prepare ();
+  virtual bool   seek (int64_t position);
+  virtual size_t readAt (uint8_t *data, size_t size, int64_t pos);
+  virtual bool   isEOS () { return m_eos; }
+  virtual size_t streamSize () { return 0; }
 
-  private:
-  size_t readData (size_t data_size, int32_t pos = 0, bool append = false);
+  protected:
+  virtual size_t readChunk (uint8_t *data, size_t size, int64_t pos);
 
-  ese_read_buffer_func m_readFunc;
-  void                *m_dataPointer;
-  bool                 m_eos;
-};
\ No newline at end of file
+  private:
+  ese_read_buffer_func64 m_readFunc64;
+  ese_read_buffer_func   m_readFunc;
+  void                  *m_dataPointer;
+  bool                   m_eos;
+};
@@ -44,10 +44,9 @@ ESEFileReader::prepare ()
 }
 
 size_t
-ESEFileReader::readFile (size_t data_size, int32_t pos, bool append)
+ESEFileReader::readChunk (uint8_t *data, size_t size, int64_t pos)
 {
-  ESEBuffer buffer;
-  size_t    read_size;
+  size_t read_size;
 
   if (!m_fileSize)
     m_fileSize = static_cast<size_t> (m_file.tellg ());
@@ -56,47 +55,10 @@ ESEFileReader::readFile (size_t data_size, int32_t pos, bool append)
     return 0;
   }
 
-  DBG ("Read %d at pos %d append %d from file size %d", data_size, pos, append,
-    m_fileSize);
+  DBG ("Read %zd at pos %" PRId64 " from file size %zd", size, pos, m_fileSize);
   m_file.clear ();
-  m_file.seekg (pos, m_file.beg);
-  m_streamPosition = pos;
-
-  buffer.resize (data_size);
-  m_file.read (reinterpret_cast<char *> (buffer.data ()), data_size);
+  m_file.seekg (static_cast<std::streamoff> (pos), m_file.beg);
+  m_file.read (reinterpret_cast<char *> (data), size);
   read_size = static_cast<size_t> (m_file.gcount ());
-  buffer.resize (read_size);
-  m_readSize += read_size;
-  m_streamPosition += static_cast<int32_t> (read_size);
-  if (append) {
-    m_buffer.insert (m_buffer.end (), buffer.begin (), buffer.end ());
-    DBG ("ReadFile: Append %d to a buffer of new size %zd read %zd", data_size,
-      m_buffer.size (), read_size);
-  } else {
-    m_buffer = buffer;
-    DBG ("ReadFile: Read buffer %d of size read %zd", data_size, read_size);
-  }
-  m_bufferSize = m_buffer.size ();
   return read_size;
 }
-
-ESEBuffer
-ESEFileReader::getBuffer (size_t size)
-{
-  size_t    real_size = size;
-  ESEBuffer buffer;
-
-  while (m_buffer.size () < size) {
-    if (readFile (bufferReadLength (), m_streamPosition,
-          true)
-      < bufferReadLength ())
-      break;
-  }
-  if (m_buffer.size () < size)
-    real_size = m_buffer.size ();
-
-  buffer = subVector (m_buffer, 0, real_size);
-  m_buffer.erase (m_buffer.begin (), m_buffer.begin () + real_size);
-  m_bufferSize = static_cast<int32_t> (m_buffer.size ());
-  return buffer;
-}
@@ -33,12 +33,11 @@ class ESEFileReader : public ESEReader {
 
   virtual bool prepare ();
 
-  virtual ESEBuffer getBuffer (size_t size);
-  virtual size_t    streamSize () { return m_fileSize; }
-  virtual bool      isEOS () { return m_bufferSize == 0 && m_readSize == streamSize (); }
+  virtual size_t streamSize () { return m_fileSize; }
+  virtual bool   isEOS () { return m_bufferSize == 0 && m_readSize == streamSize (); }
 
-  private:
-  size_t readFile (size_t data_size, int32_t pos = 0, bool append = false);
+  protected:
+  virtual size_t readChunk (uint8_t *data, size_t size, int64_t pos);
 
   std::ifstream m_file;
   std::string   m_fileName;
@@ -0,0 +1,121 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+
+#include "eseframe.h"
+
+#define AV1_OBU_SEQUENCE_HEADER 1
+#define AV1_OBU_FRAME_HEADER 3
+#define AV1_OBU_FRAME 6
+
+// Reads a leb128 value at pos, which is moved after it.
+static bool
+read_leb128 (ESEBufferView data, size_t *pos, uint64_t *value)
+{
+  *value = 0;
+  for (size_t i = 0; i < 8 && *pos < data.size (); i++) {
+    uint8_t byte = data[(*pos)++];
+    *value |= static_cast<uint64_t> (byte & 0x7F) << (i * 7);
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+static bool
+vp8_is_key_frame (ESEBufferView frame)
+{
+  // The first bit of the frame tag is 0 for a key frame.
+  return !frame.empty () && !(frame[0] & 0x01);
+}
+
+static bool
+vp9_is_key_frame (ESEBufferView frame)
+{
+  if (frame.empty () || (frame[0] >> 6) != 0x2)
+    return false;
+  // frame_marker (2), profile_low_bit, profile_high_bit, reserved_zero in
+  // profile 3, show_existing_frame and frame_type, 0 for a key frame.
+  int profile = ((frame[0] >> 5) & 0x1) | ((frame[0] >> 3) & 0x2);
+  int bit     = profile == 3 ? 5 : 4;
+  if ((frame[0] >> (7 - bit)) & 0x1)
+    return false;
+  return !((frame[0] >> (6 - bit)) & 0x1);
+}
+
+bool
+ese_av1_is_key_frame (ESEBufferView data, bool annexB)
+{
+  size_t pos     = 0;
+  bool   reduced = false;
+
+  while (pos < data.size ()) {
+    uint64_t obu_size = data.size () - pos;
+    if (annexB && (!read_leb128 (data, &pos, &obu_size) || pos >= data.size ()))
+      return false;
+    uint64_t obu_end = pos + obu_size;
+    uint8_t  header  = data[pos++];
+    int      type    = (header >> 3) & 0xF;
+    // The extension header follows the header.
+    if (header & 0x04)
+      pos++;
+    if (header & 0x02) {
+      uint64_t payload_size;
+      if (!read_leb128 (data, &pos, &payload_size))
+        return false;
+      if (!annexB)
+        obu_end = pos + payload_size;
+    }
+    if (pos > obu_end)
+      return false;
+    // The temporal delimiters are empty.
+    if (pos == obu_end)
+      continue;
+    // The data can end before the end of the frame.
+    if (pos >= data.size ())
+      return false;
+    if (type == AV1_OBU_SEQUENCE_HEADER) {
+      // seq_profile (3), still_picture, reduced_still_picture_header
+      reduced = (data[pos] >> 3) & 0x1;
+    } else if (type == AV1_OBU_FRAME_HEADER || type == AV1_OBU_FRAME) {
+      // A reduced still picture header describes a key frame, otherwise
+      // show_existing_frame is followed by frame_type, 0 for a key frame.
+      if (reduced)
+        return true;
+      return !(data[pos] & 0x80) && !((data[pos] >> 5) & 0x3);
+    }
+    if (obu_end >= data.size ())
+      break;
+    pos = static_cast<size_t> (obu_end);
+  }
+  return false;
+}
+
+bool
+ese_frame_is_key (ESEBufferView frame, ESEVideoCodec codec)
+{
+  switch (codec) {
+    case ESE_VIDEO_CODEC_VP8:
+      return vp8_is_key_frame (frame);
+    case ESE_VIDEO_CODEC_VP9:
+      return vp9_is_key_frame (frame);
+    case ESE_VIDEO_CODEC_AV1:
+      return ese_av1_is_key_frame (frame, false);
+    default:
+      return false;
+  }
+}
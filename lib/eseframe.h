@@ -0,0 +1,32 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+
+#pragma once
+
+#include "esereader.h"
+
+/// @brief Returns true if the VP8, VP9 or AV1 frame of an IVF stream is a key frame.
+/// The frame can be truncated after its frame header.
+bool
+ese_frame_is_key (ESEBufferView frame, ESEVideoCodec codec);
+
+/// @brief Returns true if the AV1 OBUs of data hold a key frame. The OBUs of
+/// an Annex B frame unit are preceded by their length, the others hold their
+/// size.
+bool
+ese_av1_is_key_frame (ESEBufferView data, bool annexB);
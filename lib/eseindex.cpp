@@ -0,0 +1,206 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <sys/stat.h>
+
+#include "eseindex.h"
+#include "eselogger.h"
+
+#define ESE_INDEX_MAGIC 0x49455345 // "ESEI"
+#define ESE_INDEX_BYTE_ORDER 0x01020304
+
+struct ESEIndexHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t entrySize;
+  uint64_t streamSize;
+  int64_t  modificationTime;
+  uint32_t format;
+  uint32_t codec;
+  uint32_t alignment;
+  uint32_t reserved;
+  uint64_t count;
+};
+
+bool
+ese_index_file_identity (const std::string &path, ESEIndexIdentity *identity)
+{
+  int64_t seconds, nanoseconds;
+#ifdef _WIN32
+  struct _stat64 st;
+  if (_stat64 (path.c_str (), &st) < 0)
+    return false;
+  // The modification time is only known to the second.
+  seconds     = static_cast<int64_t> (st.st_mtime);
+  nanoseconds = 0;
+#else
+  struct stat st;
+  if (stat (path.c_str (), &st) < 0)
+    return false;
+#  ifdef __APPLE__
+  seconds     = static_cast<int64_t> (st.st_mtimespec.tv_sec);
+  nanoseconds = static_cast<int64_t> (st.st_mtimespec.tv_nsec);
+#  else
+  seconds     = static_cast<int64_t> (st.st_mtim.tv_sec);
+  nanoseconds = static_cast<int64_t> (st.st_mtim.tv_nsec);
+#  endif
+#endif
+  identity->streamSize       = static_cast<uint64_t> (st.st_size);
+  identity->modificationTime = seconds * 1000000000 + nanoseconds;
+  return true;
+}
+
+ESEIndex::ESEIndex ()
+{
+  reset ();
+}
+
+void
+ESEIndex::reset ()
+{
+  m_entries.clear ();
+  m_complete = false;
+}
+
+void
+ESEIndex::record (uint64_t number, const ESEPacketDescriptor &descriptor)
+{
+  if (!m_complete && number == m_entries.size ())
+    m_entries.push_back (descriptor);
+}
+
+int64_t
+ESEIndex::findTime (uint64_t pts)
+{
+  std::vector<ESEPacketDescriptor>::const_iterator it = std::upper_bound (m_entries.begin (), m_entries.end (), pts,
+    [] (uint64_t value, const ESEPacketDescriptor &entry) { return value < entry.pts; });
+  return static_cast<int64_t> (it - m_entries.begin ()) - 1;
+}
+
+uint64_t
+ESEIndex::findKeyframe (uint64_t number)
+{
+  while (number > 0 && !(m_entries[number].flags & ESE_PACKET_FLAG_KEYFRAME))
+    number--;
+  return number;
+}
+
+void
+ESEIndex::finish (uint64_t count)
+{
+  if (count == m_entries.size ())
+    m_complete = true;
+}
+
+bool
+ESEIndex::load (const std::string &path, const ESEIndexIdentity &identity)
+{
+  ESEIndexHeader header;
+  std::ifstream  file (path, std::ios::binary | std::ios::ate);
+
+  if (!file.is_open ())
+    return false;
+  std::streamoff end = file.tellg ();
+  file.seekg (0, file.beg);
+  if (end < static_cast<std::streamoff> (sizeof (header)) || !file.read (reinterpret_cast<char *> (&header), sizeof (header))) {
+    ERR ("Unable to read the index header of %s", path.c_str ());
+    return false;
+  }
+  // The count is compared to the size of the table without multiplying it,
+  // which a corrupted count could overflow.
+  uint64_t table_size = static_cast<uint64_t> (end) - sizeof (header);
+  if (header.magic != ESE_INDEX_MAGIC || header.version != ESE_INDEX_VERSION
+    || header.byteOrder != ESE_INDEX_BYTE_ORDER || header.entrySize != sizeof (ESEPacketDescriptor)
+    || table_size % sizeof (ESEPacketDescriptor) || header.count != table_size / sizeof (ESEPacketDescriptor)) {
+    ERR ("The index %s is not valid", path.c_str ());
+    return false;
+  }
+  if (header.streamSize != identity.streamSize || header.modificationTime != identity.modificationTime
+    || header.format != identity.format || header.codec != identity.codec || header.alignment != identity.alignment) {
+    INFO ("The index %s does not match the stream", path.c_str ());
+    return false;
+  }
+  std::vector<ESEPacketDescriptor> entries;
+  if (header.count > entries.max_size ()) {
+    ERR ("The index %s is too large", path.c_str ());
+    return false;
+  }
+  // An index too large for the memory is not loaded rather than throwing
+  // through the API.
+  try {
+    entries.resize (static_cast<size_t> (header.count));
+  } catch (const std::exception &) {
+    ERR ("Unable to allocate the index %s", path.c_str ());
+    return false;
+  }
+  if (!file.read (reinterpret_cast<char *> (entries.data ()), static_cast<std::streamsize> (entries.size () * sizeof (ESEPacketDescriptor)))) {
+    ERR ("Unable to read the index %s", path.c_str ());
+    return false;
+  }
+  m_entries.swap (entries);
+  m_complete = true;
+  DBG ("Loaded %zd packets from the index %s", m_entries.size (), path.c_str ());
+  return true;
+}
+
+bool
+ESEIndex::save (const std::string &path, const ESEIndexIdentity &identity)
+{
+  ESEIndexHeader header;
+  // Write a temporary file first, a reader never finds a partial index.
+  std::string temporary = path + ".tmp";
+
+  if (!m_complete)
+    return false;
+  header.magic            = ESE_INDEX_MAGIC;
+  header.version          = ESE_INDEX_VERSION;
+  header.byteOrder        = ESE_INDEX_BYTE_ORDER;
+  header.entrySize        = sizeof (ESEPacketDescriptor);
+  header.streamSize       = identity.streamSize;
+  header.modificationTime = identity.modificationTime;
+  header.format           = identity.format;
+  header.codec            = identity.codec;
+  header.alignment        = identity.alignment;
+  header.reserved         = 0;
+  header.count            = m_entries.size ();
+  {
+    std::ofstream file (temporary, std::ios::binary | std::ios::trunc);
+    file.write (reinterpret_cast<const char *> (&header), sizeof (header));
+    file.write (reinterpret_cast<const char *> (m_entries.data ()), static_cast<std::streamsize> (m_entries.size () * sizeof (ESEPacketDescriptor)));
+    if (!file.good ()) {
+      ERR ("Unable to write the index %s", temporary.c_str ());
+      file.close ();
+      std::remove (temporary.c_str ());
+      return false;
+    }
+  }
+  // Windows does not replace an existing file.
+  if (std::rename (temporary.c_str (), path.c_str ()) != 0
+    && (std::remove (path.c_str ()) != 0 || std::rename (temporary.c_str (), path.c_str ()) != 0)) {
+    ERR ("Unable to write the index %s", path.c_str ());
+    std::remove (temporary.c_str ());
+    return false;
+  }
+  DBG ("Saved %zd packets to the index %s", m_entries.size (), path.c_str ());
+  return true;
+}
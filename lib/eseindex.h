@@ -0,0 +1,77 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "esextractor.h"
+
+#define ESE_INDEX_EXTENSION ".eseidx"
+// Version 2 finds the access units from the slice headers, version 3 records
+// the modification time in nanoseconds.
+#define ESE_INDEX_VERSION 3
+
+/// @brief Describes the stream an index was built from. An index is only
+/// loaded for the same file, unchanged, parsed into the same packets.
+struct ESEIndexIdentity {
+  uint64_t streamSize;
+  // Nanoseconds since the epoch.
+  int64_t  modificationTime;
+  uint32_t format;
+  uint32_t codec;
+  uint32_t alignment;
+};
+
+/// @brief Returns the identity of the file at path, or false if it can not be read.
+bool
+ese_index_file_identity (const std::string &path, ESEIndexIdentity *identity);
+
+/// @brief Locations of the packets of a stream, in order from the first one.
+/// The index file is a header followed by the ESEPacketDescriptor table, in
+/// the byte order of the host, so the table can be read or mapped at once.
+class ESEIndex {
+  public:
+  ESEIndex ();
+
+  void reset ();
+  /// @brief Appends the descriptor of packet number, if all the packets
+  /// before it are indexed.
+  void record (uint64_t number, const ESEPacketDescriptor &descriptor);
+  /// @brief Marks the index complete if it holds count packets.
+  void finish (uint64_t count);
+
+  bool                       complete () { return m_complete; }
+  uint64_t                   size () { return m_entries.size (); }
+  const ESEPacketDescriptor &entry (uint64_t number) { return m_entries[number]; }
+  /// @brief Returns the number of the last packet with a pts lower or equal
+  /// to pts, or -1 if none. The pts are increasing in the index.
+  int64_t                    findTime (uint64_t pts);
+  /// @brief Returns the number of the last key frame up to number, or 0 if none.
+  uint64_t                   findKeyframe (uint64_t number);
+
+  /// @brief Loads a complete index saved for identity.
+  bool load (const std::string &path, const ESEIndexIdentity &identity);
+  bool save (const std::string &path, const ESEIndexIdentity &identity);
+
+  private:
+  std::vector<ESEPacketDescriptor> m_entries;
+  bool                             m_complete;
+};
@@ -15,17 +15,11 @@
  * permissions and limitations under the License.
  */
 
+#include "eseframe.h"
 #include "eseivfstream.h"
 #include "eselogger.h"
 #include "esereader.h"
 
-#pragma pack(push, 1)
-struct IVFFrameHeader {
-  uint32_t frame_size;
-  uint64_t timestamp;
-};
-#pragma pack(pop)
-
 ESEIVFStream::ESEIVFStream ()
 : ESEStream (ESE_VIDEO_FORMAT_IVF)
 {
@@ -39,15 +33,86 @@ ESEIVFStream::~ESEIVFStream ()
 void
 ESEIVFStream::reset ()
 {
-  m_headerFound = false;
-  m_lastPts     = 0;
+  m_headerFound      = false;
+  m_frameHeaderFound = false;
+  m_lastPts          = 0;
   ESEStream::reset ();
 }
 
+bool
+ESEIVFStream::seek (uint64_t number)
+{
+  if (!m_index || number >= m_index->size () || !m_headerFound)
+    return false;
+  // The frame header precedes the frame data.
+  const ESEPacketDescriptor &desc = m_index->entry (number);
+  if (!m_reader->seek (static_cast<int64_t> (desc.offset - sizeof (IVFFrameHeader))))
+    return false;
+  prepareSeek (number);
+  m_frameHeaderFound = false;
+  m_lastPts          = number ? m_index->entry (number - 1).pts : 0;
+  return true;
+}
+
+bool
+ESEIVFStream::indexFrames (const std::function<bool ()> &indexed)
+{
+  uint8_t             data[sizeof (IVFFrameHeader) + IVF_KEYFRAME_PROBE_SIZE];
+  IVFFrameHeader      header;
+  ESEPacketDescriptor desc;
+
+  if (!m_index || !m_headerFound)
+    return false;
+  // The frame headers are chained from the end of the last frame indexed.
+  uint64_t number = m_index->size ();
+  uint64_t end    = m_reader->streamSize ();
+  uint64_t pos    = sizeof (IVFHeader);
+  if (number)
+    pos = m_index->entry (number - 1).offset + m_index->entry (number - 1).size;
+  while (!indexed ()) {
+    size_t read_size = m_reader->readAt (data, sizeof (data), static_cast<int64_t> (pos));
+    if (read_size < sizeof (IVFFrameHeader)) {
+      m_index->finish (number);
+      break;
+    }
+    std::memcpy (&header, data, sizeof (IVFFrameHeader));
+    pos += sizeof (IVFFrameHeader);
+    // The last frame can be truncated, as when it is read.
+    desc.offset = pos;
+    desc.size   = end - pos < header.frame_size ? end - pos : header.frame_size;
+    desc.pts    = header.timestamp;
+    desc.type   = 0;
+    desc.flags  = 0;
+    size_t probe_size = read_size - sizeof (IVFFrameHeader);
+    if (probe_size > desc.size)
+      probe_size = static_cast<size_t> (desc.size);
+    if (ese_frame_is_key (ESEBufferView (data + sizeof (IVFFrameHeader), probe_size), m_codec))
+      desc.flags = ESE_PACKET_FLAG_KEYFRAME;
+    m_index->record (number++, desc);
+    pos += desc.size;
+  }
+  return true;
+}
+
 void
 ESEIVFStream::parseOptions (const char *options)
 {
   INFO ("Create a IFV stream with options %s", options);
+  ESEStream::parseOptions (options);
+}
+
+bool
+ESEIVFStream::streamInfo (ESEStreamInfo *info)
+{
+  if (!m_headerFound)
+    return false;
+  *info                   = ESEStreamInfo ();
+  info->codec             = m_codec;
+  info->width             = m_header.width;
+  info->height            = m_header.height;
+  info->num_units_in_tick = m_header.timescale_num;
+  info->time_scale        = m_header.timescale_den;
+  return true;
 }
 
 void
@@ -81,45 +146,84 @@ ESEIVFStream::fourccToCodec ()
   return ESE_VIDEO_CODEC_UNKNOWN;
 }
 
+bool
+ESEIVFStream::fillBuffer (size_t size)
+{
+  if (m_buffer.size () < size)
+    m_reader->appendBuffer (m_buffer, size - m_buffer.size ());
+  return m_buffer.size () >= size;
+}
+
 ESEResult
 ESEIVFStream::processToNextFrame ()
 {
-  ESEResult      res = ESE_RESULT_NEW_PACKET;
-  IVFFrameHeader frame_header;
+  ESEResult res = ESE_RESULT_NEW_PACKET;
 
-  if (m_nextPacket)
+  if (m_packetReady)
     return ESE_RESULT_NEW_PACKET;
 
   if (m_reader->isEOS ())
     return ESE_RESULT_EOS;
 
+  // The headers and the frames are gathered in m_buffer until complete, as a
+  // pushed stream can provide them in several parts.
   if (!m_headerFound) {
-    m_buffer = m_reader->getBuffer (sizeof (IVFHeader));
+    if (!fillBuffer (sizeof (IVFHeader)))
+      return m_reader->isLive () ? ESE_RESULT_NO_PACKET : ESE_RESULT_EOS;
     std::memcpy (&m_header, m_buffer.data (), sizeof (IVFHeader));
+    m_buffer.clear ();
     m_headerFound = true;
     m_codec       = fourccToCodec ();
     printHeader ();
   }
-  m_buffer = m_reader->getBuffer (sizeof (IVFFrameHeader));
-  if (m_buffer.size ()) {
-    std::memcpy (&frame_header, m_buffer.data (), sizeof (IVFFrameHeader));
-
-    m_buffer       = m_reader->getBuffer (frame_header.frame_size);
-    m_currentFrame = prepareFrame (m_buffer, 0, m_buffer.size ());
-
-    prepareNextPacket (frame_header.timestamp, frame_header.timestamp,
-      m_lastPts - frame_header.timestamp);
-
-    m_lastPts = frame_header.timestamp;
-  } else {
-    DBG ("The last buffer was 0, no new packet, return EOS");
-    return ESE_RESULT_EOS;
+  if (!m_frameHeaderFound) {
+    if (!fillBuffer (sizeof (IVFFrameHeader))) {
+      if (m_reader->isLive ())
+        return ESE_RESULT_NO_PACKET;
+      DBG ("The last buffer was 0, no new packet, return EOS");
+      return ESE_RESULT_EOS;
+    }
+    std::memcpy (&m_frameHeader, m_buffer.data (), sizeof (IVFFrameHeader));
+    m_buffer.clear ();
+    m_frameHeaderFound = true;
+  }
+  // Without payload, only the start of the frame is read to find whether it
+  // is a key frame, the rest is skipped. A pushed frame is still read whole.
+  size_t read_size = m_frameHeader.frame_size;
+  if (m_descriptorOnly && !m_reader->isLive () && read_size > IVF_KEYFRAME_PROBE_SIZE)
+    read_size = IVF_KEYFRAME_PROBE_SIZE;
+  if (!fillBuffer (read_size) && m_reader->isLive ())
+    return ESE_RESULT_NO_PACKET;
+
+  // The buffer only holds the frame, it becomes the packet payload.
+  uint64_t offset   = static_cast<uint64_t> (m_reader->position ()) - m_buffer.size ();
+  uint64_t size     = m_buffer.size ();
+  bool     keyframe = ese_frame_is_key (m_buffer, m_codec);
+  if (size == read_size && read_size < m_frameHeader.frame_size) {
+    uint64_t skip_size = m_frameHeader.frame_size - read_size;
+    // The last frame can be truncated, as when it is read.
+    uint64_t stream_size = m_reader->streamSize ();
+    if (stream_size && offset + size + skip_size > stream_size)
+      skip_size = stream_size - offset - size;
+    if (!m_reader->skip (static_cast<size_t> (skip_size)))
+      DBG ("The frame is truncated at the end of the stream");
+    size += skip_size;
   }
+  if (m_descriptorOnly)
+    prepareEmptyPacket (m_frameHeader.timestamp, m_frameHeader.timestamp, m_lastPts - m_frameHeader.timestamp);
+  else
+    prepareNextPacket (m_buffer, m_frameHeader.timestamp, m_frameHeader.timestamp,
+      m_lastPts - m_frameHeader.timestamp);
+  indexPacket (offset, size, 0, keyframe);
+  m_buffer.clear ();
+  m_frameHeaderFound = false;
+
+  m_lastPts = m_frameHeader.timestamp;
   if (m_reader->isEOS ())
     res = ESE_RESULT_LAST_PACKET;
 
-  DBG ("Found a new IVF frame (%d) of size %zd", m_frameCount,
-    m_currentFrame.size ());
+  DBG ("Found a new IVF frame (%" PRIu64 ") of size %zd", m_frameCount,
+    m_packetInfo.data_size);
 
   return res;
 }
@@ -19,6 +19,10 @@
 
 #include "esestream.h"
 
+// Number of bytes of a frame read to find whether it is a key frame, which
+// holds the AV1 OBUs preceding the frame header.
+#define IVF_KEYFRAME_PROBE_SIZE 256
+
 struct IVFHeader {
   uint32_t signature; // FourCC
   uint16_t version;
@@ -32,23 +36,35 @@ struct IVFHeader {
   uint32_t unused;
 };
 
+#pragma pack(push, 1)
+struct IVFFrameHeader {
+  uint32_t frame_size;
+  uint64_t timestamp;
+};
+#pragma pack(pop)
+
 class ESEIVFStream : public ESEStream {
   public:
   ESEIVFStream ();
   ~ESEIVFStream ();
 
   virtual void reset ();
+  virtual bool seek (uint64_t number);
+  virtual bool indexFrames (const std::function<bool ()> &indexed);
+  virtual bool streamInfo (ESEStreamInfo *info);
 
   protected:
-  ESEBuffer getStartCode () { return {}; }
   ESEResult processToNextFrame ();
 
   private:
   ESEVideoCodec fourccToCodec ();
   void          printHeader ();
   void          parseOptions (const char *options);
+  bool          fillBuffer (size_t size);
 
-  IVFHeader m_header;
-  bool      m_headerFound;
-  uint64_t  m_lastPts;
+  IVFHeader      m_header;
+  bool           m_headerFound;
+  IVFFrameHeader m_frameHeader;
+  bool           m_frameHeaderFound;
+  uint64_t       m_lastPts;
 };
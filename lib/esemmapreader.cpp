@@ -0,0 +1,200 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "esemmapreader.h"
+
+#include <cstring>
+#include <limits>
+
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+ESEMmapReader::ESEMmapReader (const char *fileName)
+: m_fileSize (0)
+, m_data (nullptr)
+#ifdef _WIN32
+, m_fileHandle (INVALID_HANDLE_VALUE)
+, m_mappingHandle (nullptr)
+#else
+, m_fd (-1)
+#endif
+{
+  if (fileName)
+    m_fileName = fileName;
+  reset ();
+}
+
+ESEMmapReader::~ESEMmapReader ()
+{
+  unmap ();
+}
+
+#ifdef _WIN32
+bool
+ESEMmapReader::prepare ()
+{
+  LARGE_INTEGER size;
+
+  if (m_data)
+    return true;
+
+  if (m_fileName.empty ())
+    return false;
+
+  m_fileHandle = CreateFileA (m_fileName.c_str (), GENERIC_READ, FILE_SHARE_READ,
+    nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (m_fileHandle == INVALID_HANDLE_VALUE) {
+    DBG ("Unable to open the file %s", m_fileName.c_str ());
+    return false;
+  }
+
+  // Only regular files on disk can be mapped.
+  if (GetFileType (m_fileHandle) != FILE_TYPE_DISK || !GetFileSizeEx (m_fileHandle, &size)
+    || size.QuadPart <= 0
+    || static_cast<uint64_t> (size.QuadPart) > std::numeric_limits<size_t>::max ()) {
+    DBG ("The file %s can not be mapped", m_fileName.c_str ());
+    unmap ();
+    return false;
+  }
+  m_fileSize = static_cast<size_t> (size.QuadPart);
+
+  m_mappingHandle = CreateFileMappingA (m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (m_mappingHandle)
+    m_data = static_cast<const uint8_t *> (MapViewOfFile (m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+  if (!m_data) {
+    DBG ("Unable to map the file %s", m_fileName.c_str ());
+    unmap ();
+    return false;
+  }
+  // The view stays valid once the handles are closed.
+  m_mapping.reset (m_data, [] (const uint8_t *data) { UnmapViewOfFile (data); });
+
+  DBG ("The file %s of size %zd is now mapped", m_fileName.c_str (), m_fileSize);
+  return true;
+}
+
+void
+ESEMmapReader::unmap ()
+{
+  m_mapping = nullptr;
+  if (m_mappingHandle)
+    CloseHandle (m_mappingHandle);
+  if (m_fileHandle != INVALID_HANDLE_VALUE)
+    CloseHandle (m_fileHandle);
+  m_data          = nullptr;
+  m_mappingHandle = nullptr;
+  m_fileHandle    = INVALID_HANDLE_VALUE;
+  m_fileSize      = 0;
+}
+#else
+bool
+ESEMmapReader::prepare ()
+{
+  struct stat st;
+  void       *data;
+
+  if (m_data)
+    return true;
+
+  if (m_fileName.empty ())
+    return false;
+
+  m_fd = open (m_fileName.c_str (), O_RDONLY);
+  if (m_fd < 0) {
+    DBG ("Unable to open the file %s", m_fileName.c_str ());
+    return false;
+  }
+
+  // Only regular files can be mapped, pipes and devices use the stream reader.
+  if (fstat (m_fd, &st) < 0 || !S_ISREG (st.st_mode) || st.st_size <= 0
+    || static_cast<uint64_t> (st.st_size) > std::numeric_limits<size_t>::max ()) {
+    DBG ("The file %s can not be mapped", m_fileName.c_str ());
+    unmap ();
+    return false;
+  }
+  m_fileSize = static_cast<size_t> (st.st_size);
+
+  data = mmap (nullptr, m_fileSize, PROT_READ, MAP_PRIVATE, m_fd, 0);
+  if (data == MAP_FAILED) {
+    DBG ("Unable to map the file %s", m_fileName.c_str ());
+    unmap ();
+    return false;
+  }
+  m_data          = static_cast<const uint8_t *> (data);
+  size_t map_size = m_fileSize;
+  m_mapping.reset (m_data, [map_size] (const uint8_t *data) { munmap (const_cast<uint8_t *> (data), map_size); });
+#  ifdef MADV_SEQUENTIAL
+  madvise (data, m_fileSize, MADV_SEQUENTIAL);
+#  endif
+
+  DBG ("The file %s of size %zd is now mapped", m_fileName.c_str (), m_fileSize);
+  return true;
+}
+
+void
+ESEMmapReader::unmap ()
+{
+  m_mapping = nullptr;
+  if (m_fd >= 0)
+    close (m_fd);
+  m_data     = nullptr;
+  m_fd       = -1;
+  m_fileSize = 0;
+}
+#endif
+
+size_t
+ESEMmapReader::appendBuffer (ESEBuffer &buffer, size_t size)
+{
+  size_t position  = static_cast<size_t> (m_streamPosition);
+  size_t real_size = size;
+
+  if (position + real_size > m_fileSize)
+    real_size = m_fileSize - position;
+
+  // Single copy from the mapping to the buffer.
+  buffer.insert (buffer.end (), m_data + position, m_data + position + real_size);
+  m_streamPosition += static_cast<int64_t> (real_size);
+  m_readSize = static_cast<size_t> (m_streamPosition);
+  DBG ("Read %zd bytes at pos %zd from file size %zd", real_size, position, m_fileSize);
+  return real_size;
+}
+
+size_t
+ESEMmapReader::readChunk (uint8_t *data, size_t size, int64_t pos)
+{
+  size_t position = static_cast<size_t> (pos);
+
+  if (position >= m_fileSize)
+    return 0;
+  if (position + size > m_fileSize)
+    size = m_fileSize - position;
+  std::memcpy (data, m_data + position, size);
+  return size;
+}
@@ -0,0 +1,59 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "esereader.h"
+#include "eseutils.h"
+
+/// @brief Reader mapping a regular file in memory.
+/// The buffers are built straight from the mapping, without any intermediate
+/// read or copy in the reader itself.
+class ESEMmapReader : public ESEReader {
+  public:
+  ESEMmapReader (const char *fileName);
+  ~ESEMmapReader ();
+
+  virtual bool prepare ();
+
+  virtual size_t                         appendBuffer (ESEBuffer &buffer, size_t size);
+  virtual size_t                         streamSize () { return m_fileSize; }
+  virtual bool                           isEOS () { return static_cast<size_t> (m_streamPosition) >= m_fileSize; }
+  virtual std::shared_ptr<const uint8_t> mapping () { return m_mapping; }
+
+  protected:
+  virtual size_t readChunk (uint8_t *data, size_t size, int64_t pos);
+
+  private:
+  void unmap ();
+
+  std::string    m_fileName;
+  size_t         m_fileSize;
+  const uint8_t *m_data;
+  // Unmaps the file once released by the reader and the borrowed packets.
+  std::shared_ptr<const uint8_t> m_mapping;
+#ifdef _WIN32
+  void *m_fileHandle;
+  void *m_mappingHandle;
+#else
+  int m_fd;
+#endif
+};
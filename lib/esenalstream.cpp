@@ -15,6 +15,8 @@
  * permissions and limitations under the License.
  */
 
+#include <cstdlib>
+
 #include "esenalstream.h"
 #include "eselogger.h"
 #include "esenalu.h"
@@ -33,15 +35,76 @@ ESENALStream::~ESENALStream ()
 void
 ESENALStream::reset ()
 {
-  m_frameState     = ESE_NAL_FRAME_STATE_NONE;
-  m_frameStartPos  = 0;
-  m_nalCount       = false;
-  m_mpegDetected   = false;
-  m_audNalDetected = false;
-  m_alignment      = ESE_PACKET_ALIGNMENT_NAL;
-  m_nextNAL        = ESEBuffer ();
-  m_nextFrame      = ESEBuffer ();
+  m_frameStartPos    = 0;
+  m_frameStartOffset = 0;
+  m_nextOffset       = 0;
+  m_nextSize         = 0;
+  m_maxFrameSize     = 0;
+  m_bufferOffset     = 0;
+  m_nalCount         = false;
+  m_mpegDetected     = false;
+  m_audNalDetected   = false;
+  m_alignment        = ESE_PACKET_ALIGNMENT_NAL;
+  m_dropFlags        = 0;
+  m_maxTemporalId    = -1;
+  m_nextDropped      = false;
+  m_nextFrame        = ESEBuffer ();
+  m_nextView         = ESEBufferView ();
+  m_mapping          = nullptr;
+  m_parameterSets.reset ();
+  m_scanner.reset ();
   ESEStream::reset ();
+  clearAccessUnit ();
+}
+
+bool
+ESENALStream::seek (uint64_t number)
+{
+  if (!m_index || number >= m_index->size () || !m_mpegDetected)
+    return false;
+  // A NAL or an access unit starts with the start code of its first NAL.
+  int64_t offset = static_cast<int64_t> (m_index->entry (number).offset);
+  if (!m_reader->seek (offset))
+    return false;
+  prepareSeek (number);
+  m_nextFrame.clear ();
+  m_nextView    = ESEBufferView ();
+  m_nextDropped = false;
+  clearAccessUnit ();
+  m_scanner.reset ();
+  m_frameStartPos    = 0;
+  m_frameStartOffset = offset;
+  // The mapped stream is scanned from its start, the buffer from offset.
+  m_bufferOffset = m_mapping ? 0 : offset;
+  if (!m_mapping)
+    appendBuffer ();
+  ESEBufferView data  = streamData ();
+  size_t        start = static_cast<size_t> (offset - m_bufferOffset);
+  if (start + MPEG_HEADER_SIZE >= data.size ())
+    return false;
+  m_frameStartPos  = start + (data[start + 2] == 0x01 ? MPEG_HEADER_SIZE : MPEG_HEADER_SIZE + 1);
+  m_bufferPosition = m_frameStartPos;
+  return true;
+}
+
+bool
+ESENALStream::isKeyframePacket (const ESEPacketDescriptor &descriptor)
+{
+  // The parameter set NALs are kept with the key frames, which need them.
+  if (m_alignment == ESE_PACKET_ALIGNMENT_NAL) {
+    ESENaluCategory category = m_codec == ESE_VIDEO_CODEC_H264 ? ese_h264_nalu_categories[descriptor.type & 0x1F]
+                                                               : ese_h265_nalu_categories[descriptor.type & 0x3F];
+    if (category == ESE_NALU_CATEGORY_PARAMETER_SET)
+      return true;
+  }
+  return ESEStream::isKeyframePacket (descriptor);
+}
+
+ESEBufferView
+ESENALStream::getStartCode ()
+{
+  static const uint8_t start_code[] = { 0x00, 0x00, 0x00, 0x01 };
+  return ESEBufferView (start_code, sizeof (start_code));
 }
 
 const char *
@@ -64,100 +127,189 @@ ESENALStream::parseOptions (const char *options)
     m_alignment = ESE_PACKET_ALIGNMENT_NAL;
   else if (m_options["alignment"] == "AU")
     m_alignment = ESE_PACKET_ALIGNMENT_AU;
+  std::string drop = option ("drop-nals");
+  size_t      pos  = 0;
+  while (pos < drop.size ()) {
+    size_t      next = drop.find (',', pos);
+    std::string name = drop.substr (pos, next == std::string::npos ? std::string::npos : next - pos);
+    if (name == "sei")
+      m_dropFlags |= ESE_NAL_DROP_SEI;
+    else if (name == "filler")
+      m_dropFlags |= ESE_NAL_DROP_FILLER;
+    else if (name == "non-reference")
+      m_dropFlags |= ESE_NAL_DROP_NON_REFERENCE;
+    else if (name == "layers")
+      m_dropFlags |= ESE_NAL_DROP_LAYERS;
+    else
+      ERR ("Unknown NAL class %s to drop", name.c_str ());
+    pos = next == std::string::npos ? drop.size () : next + 1;
+  }
+  if (!option ("max-temporal-id").empty ())
+    m_maxTemporalId = static_cast<int> (strtol (option ("max-temporal-id").c_str (), nullptr, 10));
   INFO ("Create a NAL stream with alignment %s", alignmentName ());
 }
 
-int32_t
-ESENALStream::parseStream (int32_t start_position)
-{
-  int32_t pos         = start_position;
-  int32_t buffer_size = static_cast<int32_t> (m_buffer.size ());
-
-  while (pos < buffer_size) {
-    if (!m_mpegDetected) {
-      pos = probeH26x ();
-      if (pos > 0) {
-        /* start code might have 2 or 3 0-bytes */
-        m_frameStartPos = pos;
-        m_frameState    = ESE_NAL_FRAME_STATE_START;
-        m_mpegDetected  = true;
-      } else {
-        ERR ("Unable to find any start code in buffer size %d. Exit.",
-          buffer_size);
-        return -1;
-      }
-    } else if (m_mpegDetected && m_codec != ESE_VIDEO_CODEC_UNKNOWN) {
-      pos = scanMPEGHeader (m_buffer, pos);
-      if (pos >= 0) {
-        DBG ("Found a NAL delimiter, stop pos %d ", pos);
-        if (m_frameState == ESE_NAL_FRAME_STATE_NONE) {
-          m_frameState = ESE_NAL_FRAME_STATE_START;
-          pos += MPEG_HEADER_SIZE;
-          m_frameStartPos = pos;
-        } else {
-          m_frameState = ESE_NAL_FRAME_STATE_END;
-          if (m_buffer[pos - 1] == 0x00)
-            pos -= 1;
-        }
-        return pos;
-      } else {
-        DBG ("Unable to find a new MPEG code, end of file");
-        pos = buffer_size;
-      }
-    }
+bool
+ESENALStream::isDroppedNal (ESEBufferView data, size_t start, size_t end)
+{
+  if ((!m_dropFlags && m_maxTemporalId < 0) || start >= end)
+    return false;
+  uint8_t header = data[start];
+  if (m_codec == ESE_VIDEO_CODEC_H264) {
+    int type = header & 0x1F;
+    if (type == ESE_H264_NAL_SEI)
+      return (m_dropFlags & ESE_NAL_DROP_SEI) != 0;
+    if (type == ESE_H264_NAL_FILLER_DATA)
+      return (m_dropFlags & ESE_NAL_DROP_FILLER) != 0;
+    // The SVC and MVC NALs carry the layers above the base one.
+    if (type == ESE_H264_NAL_PREFIX_UNIT || type == ESE_H264_NAL_SUBSET_SPS || type == ESE_H264_NAL_SLICE_EXT)
+      return (m_dropFlags & ESE_NAL_DROP_LAYERS) != 0;
+    // nal_ref_idc is 0 for the slices of the non-reference pictures.
+    return (m_dropFlags & ESE_NAL_DROP_NON_REFERENCE) && ese_h264_nalu_categories[type] == ESE_NALU_CATEGORY_SLICE && !(header & 0x60);
   }
+  // The H.265 header holds nuh_layer_id and nuh_temporal_id_plus1 in its second byte.
+  if (start + 1 >= end)
+    return false;
+  int type        = (header & 0x7E) >> 1;
+  int layer       = (header & 0x01) << 5 | data[start + 1] >> 3;
+  int temporal_id = (data[start + 1] & 0x07) - 1;
+  if (m_maxTemporalId >= 0 && temporal_id > m_maxTemporalId)
+    return true;
+  if (layer && (m_dropFlags & ESE_NAL_DROP_LAYERS))
+    return true;
+  if (type == ESE_H265_NAL_PREFIX_SEI || type == ESE_H265_NAL_SUFFIX_SEI)
+    return (m_dropFlags & ESE_NAL_DROP_SEI) != 0;
+  if (type == ESE_H265_NAL_FD)
+    return (m_dropFlags & ESE_NAL_DROP_FILLER) != 0;
+  // The even VCL types are the sub-layer non-reference pictures.
+  return (m_dropFlags & ESE_NAL_DROP_NON_REFERENCE) && type < ESE_H265_NAL_SLICE_BLA_W_LP && !(type & 1);
+}
 
-  return pos;
+size_t
+ESENALStream::appendBuffer ()
+{
+  size_t read_length = m_reader->bufferReadLength () >= MINIMUM_HEADER_SEARCH_FRAME ? m_reader->bufferReadLength () : MINIMUM_HEADER_SEARCH_FRAME;
+  size_t frame_size  = m_buffer.size () - m_frameStartPos;
+
+  // Drop the previous NALs, so the buffer only holds the current NAL and its
+  // size is bounded by the largest NAL. The moved bytes are at most the next
+  // read length, as it grows with the NAL.
+  if (m_frameStartPos) {
+    m_buffer.erase (m_buffer.begin (), m_buffer.begin () + m_frameStartPos);
+    m_bufferOffset += static_cast<int64_t> (m_frameStartPos);
+    m_bufferPosition -= m_frameStartPos;
+    m_frameStartPos = 0;
+  }
+  // Read larger chunks as a NAL grows, up to MAXIMUM_READ_LENGTH.
+  if (frame_size > read_length)
+    read_length = frame_size < MAXIMUM_READ_LENGTH ? frame_size : MAXIMUM_READ_LENGTH;
+  // Keep room for the largest NAL found and the read following it, so the
+  // buffer stops growing once the stream has been read whatever the read positions.
+  size_t room = m_maxFrameSize < MAXIMUM_READ_LENGTH ? m_maxFrameSize : MAXIMUM_READ_LENGTH;
+  room        = m_maxFrameSize + (room > read_length ? room : read_length);
+  if (m_buffer.capacity () < room)
+    m_buffer.reserve (room);
+
+  return m_reader->appendBuffer (m_buffer, read_length);
+}
+
+ESEBufferView
+ESENALStream::streamData ()
+{
+  if (m_mapping)
+    return ESEBufferView (m_mapping.get (), m_reader->streamSize ());
+  return m_buffer;
+}
+
+void
+ESENALStream::prepareNextFrame (ESEBufferView data, size_t end)
+{
+  m_nextOffset  = static_cast<uint64_t> (m_frameStartOffset);
+  m_nextSize    = static_cast<uint64_t> (m_bufferOffset + static_cast<int64_t> (end) - m_frameStartOffset);
+  m_nextDropped = isDroppedNal (data, m_frameStartPos, end);
+  if (!m_mapping) {
+    size_t frame_size = getStartCode ().size () + end - m_frameStartPos;
+    if (frame_size > m_maxFrameSize)
+      m_maxFrameSize = frame_size;
+    // Without payload, only the NAL header is copied to classify the NAL,
+    // the parameter sets being parsed.
+    bool parameter_set = m_frameStartPos < end
+      && ese_nalu_header_category (data[m_frameStartPos], static_cast<ESENaluCodec> (m_codec)) == ESE_NALU_CATEGORY_PARAMETER_SET;
+    if (((m_descriptorOnly && !parameter_set) || m_nextDropped) && end - m_frameStartPos > NAL_HEADER_PROBE_SIZE)
+      end = m_frameStartPos + NAL_HEADER_PROBE_SIZE;
+    prepareFrame (data, m_frameStartPos, end, m_nextFrame);
+    return;
+  }
+  // Keep the start code of the stream, the mapping starts at offset 0.
+  m_nextView = data.subView (static_cast<size_t> (m_nextOffset), static_cast<size_t> (m_nextSize));
 }
 
 ESEResult
 ESENALStream::readStream ()
 {
-  int32_t pos;
-
   if (m_eos) {
-    m_nextFrame = ESEBuffer ();
+    m_nextFrame   = ESEBuffer ();
+    m_nextView    = ESEBufferView ();
+    m_nextDropped = false;
     return ESE_RESULT_EOS;
   }
 
-  if (m_bufferPosition >= static_cast<uint32_t> (m_buffer.size ())) {
-    m_buffer = m_reader->getBuffer (m_reader->bufferReadLength () >= MINIMUM_HEADER_SEARCH_FRAME ? m_reader->bufferReadLength () : MINIMUM_HEADER_SEARCH_FRAME);
-  }
-  while (m_bufferPosition <= static_cast<uint32_t> (m_buffer.size ()) || !m_reader->isEOS ()) {
-    pos = parseStream (m_bufferPosition);
-    if (pos == static_cast<int32_t> (-1)) {
+  if (!m_mpegDetected) {
+    int64_t pos = probeH26x ();
+    if (pos <= 0) {
+      ERR ("Unable to find any start code in buffer size %zd. Exit.", m_buffer.size ());
       return ESE_RESULT_NO_PACKET;
-    } else {
-      if (m_frameState == ESE_NAL_FRAME_STATE_END) {
-        m_nextFrame = prepareFrame (m_buffer, m_frameStartPos, pos);
-        m_nalCount++;
-        DBG ("Found a new frame (%d) of size %zd at pos %d", m_nalCount,
-          m_nextFrame.size (), m_reader->streamPosition () + m_frameStartPos);
-        m_frameStartPos  = pos;
-        m_bufferPosition = pos;
-        m_frameState     = ESE_NAL_FRAME_STATE_NONE;
-        return ESE_RESULT_NEW_PACKET;
-      } else {
-        m_bufferPosition = pos;
-        if (m_bufferPosition >= static_cast<uint32_t> (m_buffer.size ())) {
-          if (m_reader->isEOS ()) {
-            m_nextFrame = prepareFrame (m_buffer, m_frameStartPos, m_buffer.size ());
-            m_nalCount++;
-            DBG ("Found a last frame (%d) of size %zd at pos %d",
-              m_nalCount, m_nextFrame.size (),
-              m_reader->streamPosition () + m_frameStartPos);
-            m_eos = true;
-            return ESE_RESULT_LAST_PACKET;
-          } else {
-            ESEBuffer buffer = m_reader->getBuffer (m_reader->bufferReadLength () >= MINIMUM_HEADER_SEARCH_FRAME ? m_reader->bufferReadLength () : MINIMUM_HEADER_SEARCH_FRAME);
-            m_buffer.insert (m_buffer.end (), buffer.begin (), buffer.end ());
-            m_bufferPosition -= MPEG_HEADER_SIZE;
-          }
-        }
-      }
+    }
+    m_bufferOffset   = 0;
+    m_bufferPosition = static_cast<size_t> (pos);
+    m_frameStartPos  = static_cast<size_t> (pos);
+    // The start code has an optional leading zero.
+    m_frameStartOffset = pos - MPEG_HEADER_SIZE;
+    if (m_frameStartOffset && m_buffer[static_cast<size_t> (m_frameStartOffset) - 1] == 0x00)
+      m_frameStartOffset--;
+    m_mpegDetected   = true;
+    m_scanner.reset ();
+    if (m_options["packet-data"] == "borrow" || m_descriptorOnly) {
+      m_mapping = m_reader->mapping ();
+      if (!m_mapping && !m_descriptorOnly)
+        INFO ("The reader does not map the stream, the packets are copied");
     }
   }
-  return ESE_RESULT_NO_PACKET;
+
+  while (true) {
+    ESEBufferView data = streamData ();
+    // Only the bytes appended since the last call are scanned.
+    size_t pos = m_scanner.scan (data.data (), m_bufferPosition, data.size ());
+    if (pos < data.size ()) {
+      DBG ("Found a NAL delimiter, stop pos %zd", pos);
+      m_bufferPosition = pos + MPEG_HEADER_SIZE;
+      /* start code might have 2 or 3 0-bytes */
+      if (pos > m_frameStartPos && data[pos - 1] == 0x00)
+        pos -= 1;
+      prepareNextFrame (data, pos);
+      m_nalCount++;
+      DBG ("Found a new frame (%" PRIu64 ") of size %zd at pos %" PRId64, m_nalCount,
+        pos - m_frameStartPos, m_bufferOffset + static_cast<int64_t> (m_frameStartPos));
+      m_frameStartPos    = m_bufferPosition;
+      m_frameStartOffset = m_bufferOffset + static_cast<int64_t> (pos);
+      return ESE_RESULT_NEW_PACKET;
+    }
+    m_bufferPosition = data.size ();
+    // A mapped stream is scanned at once.
+    if (!m_mapping && !m_reader->isEOS ()) {
+      if (appendBuffer ())
+        continue;
+      // Wait for more data, the scan resumes from the current position.
+      if (m_reader->isLive ())
+        return ESE_RESULT_NO_PACKET;
+    }
+    prepareNextFrame (data, data.size ());
+    m_nalCount++;
+    DBG ("Found a last frame (%" PRIu64 ") of size %zd at pos %" PRId64,
+      m_nalCount, data.size () - m_frameStartPos, m_bufferOffset + static_cast<int64_t> (m_frameStartPos));
+    m_eos = true;
+    return ESE_RESULT_LAST_PACKET;
+  }
 }
 
 ESEResult
@@ -165,33 +317,203 @@ ESENALStream::processToNextFrame ()
 {
   ESEResult res;
 
-  if (m_nextPacket)
+  if (m_packetReady)
     return ESE_RESULT_NEW_PACKET;
 
+  // The codec is known once the stream has been read.
   if (m_alignment == ESE_PACKET_ALIGNMENT_NAL) {
-    res = readStream ();
+    // The dropped NALs are neither returned nor indexed.
+    do
+      res = readStream ();
+    while (res == ESE_RESULT_NEW_PACKET && m_nextDropped);
+    if (res == ESE_RESULT_LAST_PACKET && m_nextDropped)
+      res = ESE_RESULT_EOS;
     if (res <= ESE_RESULT_LAST_PACKET) {
-      m_currentFrame = m_nextFrame;
-      prepareNextPacket ();
+      ESENaluCodec  codec = static_cast<ESENaluCodec> (m_codec);
+      ESEBufferView nal  = m_mapping ? m_nextView : ESEBufferView (m_nextFrame);
+      int           type = ese_nalu_get_type (nal, codec);
+      if (ese_nalu_get_category (nal, codec) == ESE_NALU_CATEGORY_PARAMETER_SET)
+        m_parameterSets.update (nal, codec);
+      if (m_descriptorOnly)
+        prepareEmptyPacket ();
+      else if (m_mapping)
+        prepareBorrowedPacket (m_nextView, m_mapping);
+      else
+        prepareNextPacket (m_nextFrame);
+      indexPacket (m_nextOffset, m_nextSize, type < 0 ? 0 : static_cast<uint32_t> (type), ese_nalu_type_is_keyframe (type, codec));
     }
   } else {
-    m_currentFrame = {};
+    // An access unit is prepared once the first NAL of the next one is read,
+    // or at the end of the stream.
     while ((res = readStream ()) <= ESE_RESULT_EOS) {
-      if (!ese_is_aud_nalu (m_nextFrame, static_cast<ESENaluCodec> (m_codec))) {
-        m_currentFrame.insert (m_currentFrame.end (), m_nextFrame.begin (),
-          m_nextFrame.end ());
+      if (res == ESE_RESULT_EOS) {
+        // The last access unit is returned with the end of the stream.
+        if (m_auHasSlice) {
+          prepareAccessUnit (m_auRanges.size ());
+          res = ESE_RESULT_LAST_PACKET;
+        }
+        clearAccessUnit ();
+        break;
       }
-      if (res == ESE_RESULT_EOS
-        || ese_is_new_frame (m_nextFrame, static_cast<ESENaluCodec> (m_codec))) {
-        if (m_currentFrame.size () > 0) {
-          const ESEBuffer &audNalu = ese_aud_nalu (static_cast<ESENaluCodec> (m_codec));
-          m_currentFrame.insert (m_currentFrame.begin (), audNalu.begin (),
-            audNalu.end ());
-          prepareNextPacket ();
+      ESENaluCodec    codec    = static_cast<ESENaluCodec> (m_codec);
+      ESEBufferView   nal      = m_mapping ? m_nextView : ESEBufferView (m_nextFrame);
+      ESENaluCategory category = ese_nalu_get_category (nal, codec);
+      int             type     = ese_nalu_get_type (nal, codec);
+      bool            picture  = startsPicture (nal, category);
+      bool            starts   = picture || ese_nalu_type_starts_access_unit (type, codec);
+      size_t          count    = 0;
+
+      if (category == ESE_NALU_CATEGORY_AUD)
+        count = m_auRanges.size ();
+      else if (picture)
+        count = m_auNextStart;
+      if (count && m_auHasSlice)
+        prepareAccessUnit (count);
+      if (starts)
+        m_pictureDropped = false;
+
+      if (m_nextDropped) {
+        // The NALs which may precede a dropped picture go with it, except
+        // the parameter sets.
+        if (picture) {
+          dropAccessUnitData ();
+          m_pictureDropped = true;
+        }
+      } else if (!nal.empty () && category != ESE_NALU_CATEGORY_AUD && !(m_pictureDropped && !starts)) {
+        ESENALRange range = { 0, nal.size (), category, type, m_nextOffset, m_nextOffset + m_nextSize };
+        if (category == ESE_NALU_CATEGORY_PARAMETER_SET)
+          m_parameterSets.update (nal, codec);
+        if (m_mapping) {
+          range.offset = static_cast<size_t> (nal.data () - m_mapping.get ());
+        } else if (!m_descriptorOnly) {
+          range.offset = m_currentFrame.size ();
+          m_currentFrame.insert (m_currentFrame.end (), nal.begin (), nal.end ());
+        }
+        m_auRanges.push_back (range);
+        if (category == ESE_NALU_CATEGORY_SLICE) {
+          m_auHasSlice  = true;
+          m_auNextStart = m_auRanges.size ();
+        } else if (!starts && m_auNextStart == m_auRanges.size () - 1) {
+          // The NALs following the last slice, which can not start an access
+          // unit, are part of it.
+          m_auNextStart = m_auRanges.size ();
         }
+      }
+      // The last NAL read belongs to the next access unit.
+      if (m_packetReady) {
+        res = ESE_RESULT_NEW_PACKET;
         break;
       }
     }
   }
   return res;
 }
+
+void
+ESENALStream::prepareAccessUnit (size_t count)
+{
+  const ESEBuffer   &audNalu  = ese_aud_nalu (static_cast<ESENaluCodec> (m_codec));
+  const uint8_t     *base     = m_mapping ? m_mapping.get () : m_currentFrame.data ();
+  const ESENALRange &first    = m_auRanges[0];
+  const ESENALRange &last     = m_auRanges[count - 1];
+  bool               keyframe = false;
+  ESESlice           slice;
+
+  for (size_t i = 0; i < count; i++)
+    keyframe |= ese_nalu_type_is_keyframe (m_auRanges[i].type, static_cast<ESENaluCodec> (m_codec));
+  // The NALs starting the next access unit are kept out of the packet.
+  if (!m_mapping && !m_descriptorOnly && count < m_auRanges.size ())
+    m_auNextFrame.assign (m_currentFrame.begin () + static_cast<std::ptrdiff_t> (m_auRanges[count].offset), m_currentFrame.end ());
+  if (m_descriptorOnly) {
+    prepareEmptyPacket ();
+  } else {
+    // The AUD and the NALs are gathered when the packet is read, without
+    // moving the access unit to insert the AUD first.
+    m_auSlices.clear ();
+    slice.data = audNalu.data ();
+    slice.size = audNalu.size ();
+    m_auSlices.push_back (slice);
+    for (size_t i = 0; i < count; i++) {
+      slice.data = base + m_auRanges[i].offset;
+      slice.size = m_auRanges[i].size;
+      m_auSlices.push_back (slice);
+    }
+    prepareGatheredPacket (m_currentFrame, m_auSlices, m_mapping);
+  }
+  indexPacket (first.streamOffset, last.streamEnd - first.streamOffset, last.type < 0 ? 0 : static_cast<uint32_t> (last.type), keyframe);
+
+  // The remaining NALs start the next access unit.
+  m_currentFrame.clear ();
+  if (!m_mapping && !m_descriptorOnly && count < m_auRanges.size ()) {
+    size_t shift = m_auRanges[count].offset;
+    m_currentFrame.swap (m_auNextFrame);
+    for (size_t i = count; i < m_auRanges.size (); i++)
+      m_auRanges[i].offset -= shift;
+  }
+  m_auRanges.erase (m_auRanges.begin (), m_auRanges.begin () + static_cast<std::ptrdiff_t> (count));
+  m_auHasSlice  = false;
+  m_auNextStart = 0;
+}
+
+void
+ESENALStream::dropAccessUnitData ()
+{
+  size_t kept = 0;
+  size_t end  = 0;
+
+  // Only the parameter sets are kept, moved to the start of m_currentFrame
+  // when it holds the NALs.
+  for (const ESENALRange &range : m_auRanges) {
+    if (range.category != ESE_NALU_CATEGORY_PARAMETER_SET)
+      continue;
+    ESENALRange moved = range;
+    if (!m_mapping && !m_descriptorOnly) {
+      memmove (m_currentFrame.data () + end, m_currentFrame.data () + range.offset, range.size);
+      moved.offset = end;
+      end += range.size;
+    }
+    m_auRanges[kept++] = moved;
+  }
+  m_auRanges.resize (kept);
+  if (!m_mapping && !m_descriptorOnly)
+    m_currentFrame.resize (end);
+  m_auHasSlice  = false;
+  m_auNextStart = kept;
+}
+
+void
+ESENALStream::clearAccessUnit ()
+{
+  m_currentFrame.clear ();
+  m_auRanges.clear ();
+  m_auHasSlice      = false;
+  m_auNextStart     = 0;
+  m_pictureDropped  = false;
+  m_lastSliceParsed = false;
+}
+
+bool
+ESENALStream::startsPicture (ESEBufferView nal, ESENaluCategory category)
+{
+  size_t pos = ese_nalu_header_position (nal);
+
+  if (category != ESE_NALU_CATEGORY_SLICE || !pos)
+    return false;
+  if (m_codec == ESE_VIDEO_CODEC_H265) {
+    // first_slice_segment_in_pic_flag, the pictures of the other layers
+    // being part of the access unit of the base layer picture.
+    if (pos + 2 >= nal.size () || (nal[pos] & 0x01) || (nal[pos + 1] >> 3))
+      return false;
+    return (nal[pos + 2] & 0x80) != 0;
+  }
+  // The data partitions B and C follow the partition A of their slice.
+  int type = nal[pos] & 0x1F;
+  if (type == ESE_H264_NAL_SLICE_DPB || type == ESE_H264_NAL_SLICE_DPC)
+    return false;
+  ESEH264SliceHeader header;
+  bool               parsed  = m_parameterSets.parseH264SliceHeader (nal, &header);
+  bool               picture = parsed && m_lastSliceParsed ? ese_h264_is_new_picture (m_lastSlice, header) : !header.first_mb_in_slice;
+  m_lastSlice                = header;
+  m_lastSliceParsed          = parsed;
+  return picture;
+}
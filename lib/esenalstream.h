@@ -19,22 +19,42 @@
 
 #include <vector>
 
+#include "esenalu.h"
+#include "eseparamsets.h"
+#include "esescan.h"
 #include "esestream.h"
 
 #define MPEG_HEADER_SIZE 3
 #define MINIMUM_HEADER_SEARCH_FRAME (2 * MPEG_HEADER_SIZE)
+#define MAXIMUM_READ_LENGTH (1024 * 1024)
+// Number of bytes of a NAL kept to classify it, and to find whether a slice
+// starts a picture, when its payload is not gathered.
+#define NAL_HEADER_PROBE_SIZE 32
+
+/// @brief Location of a NAL of the current access unit, in the mapping or in
+/// m_currentFrame, and in the stream with its start code.
+struct ESENALRange {
+  size_t          offset;
+  size_t          size;
+  ESENaluCategory category;
+  int             type;
+  uint64_t        streamOffset;
+  uint64_t        streamEnd;
+};
+
+/// @brief Classes of NALs dropped with the "drop-nals" option.
+typedef enum ESENALDropFlags {
+  ESE_NAL_DROP_SEI           = 1 << 0,
+  ESE_NAL_DROP_FILLER        = 1 << 1,
+  ESE_NAL_DROP_NON_REFERENCE = 1 << 2,
+  ESE_NAL_DROP_LAYERS        = 1 << 3,
+} ESENALDropFlags;
 
 typedef enum ESEPacketAlignment {
   ESE_PACKET_ALIGNMENT_NAL = 0,
   ESE_PACKET_ALIGNMENT_AU,
 } ESEPacketAlignment;
 
-typedef enum _ESENALFrameState {
-  ESE_NAL_FRAME_STATE_NONE = 0,
-  ESE_NAL_FRAME_STATE_START,
-  ESE_NAL_FRAME_STATE_END,
-} ESENALFrameState;
-
 class ESENALStream : public ESEStream {
 
   public:
@@ -46,26 +66,71 @@ class ESENALStream : public ESEStream {
   ESEResult processToNextFrame ();
   /// @brief Returns the NAL count.
   /// @return
-  int nalCount () { return m_nalCount; }
+  int64_t nalCount () { return static_cast<int64_t> (m_nalCount); }
   /// @brief Set frame format, either NAL or a complete access unit.
   /// @param alignment
 
-  void parseOptions (const char *options);
+  void     parseOptions (const char *options);
+  // The index of a filtered stream only holds the NALs kept.
+  uint32_t packetAlignment ()
+  {
+    return m_alignment | m_dropFlags << 8 | static_cast<uint32_t> (m_maxTemporalId + 1) << 16;
+  }
+  bool     isKeyframePacket (const ESEPacketDescriptor &descriptor);
+  bool     seek (uint64_t number);
+  bool     streamInfo (ESEStreamInfo *info) { return m_parameterSets.streamInfo (info); }
 
   protected:
-  ESEBuffer getStartCode () { return { 0x00, 0x00, 0x00, 0x01 }; }
+  ESEBufferView getStartCode ();
 
   private:
-  ESEResult   readStream ();
-  int32_t     parseStream (int32_t start_position);
-  const char *alignmentName ();
+  ESEResult     readStream ();
+  size_t        appendBuffer ();
+  ESEBufferView streamData ();
+  void          prepareNextFrame (ESEBufferView data, size_t end);
+  void          prepareAccessUnit (size_t count);
+  bool          isDroppedNal (ESEBufferView data, size_t start, size_t end);
+  bool          startsPicture (ESEBufferView nal, ESENaluCategory category);
+  void          dropAccessUnitData ();
+  void          clearAccessUnit ();
+  const char   *alignmentName ();
 
-  ESENALFrameState   m_frameState;
-  int32_t            m_frameStartPos;
-  uint32_t           m_nalCount;
-  bool               m_mpegDetected;
-  ESEBuffer          m_nextNAL;
-  bool               m_audNalDetected;
-  ESEPacketAlignment m_alignment;
-  ESEBuffer          m_nextFrame;
+  ESEStartCodeScanner m_scanner;
+  size_t              m_frameStartPos;
+  // Stream offset of the start code of the NAL at m_frameStartPos.
+  int64_t             m_frameStartOffset;
+  size_t              m_maxFrameSize;
+  int64_t             m_bufferOffset;
+  uint64_t            m_nalCount;
+  bool                m_mpegDetected;
+  bool                m_audNalDetected;
+  ESEPacketAlignment  m_alignment;
+  // NALs dropped before being copied, ESENALDropFlags and the highest H.265
+  // temporal id kept, -1 to keep them all.
+  uint32_t            m_dropFlags;
+  int                 m_maxTemporalId;
+  bool                m_nextDropped;
+  ESEBuffer           m_nextFrame;
+  // Location of m_nextFrame in the stream, with its start code.
+  uint64_t            m_nextOffset;
+  uint64_t            m_nextSize;
+  // With packet-data:borrow or none, the NALs are found and returned from
+  // the reader mapping instead of being copied.
+  std::shared_ptr<const uint8_t> m_mapping;
+  ESEBufferView                  m_nextView;
+  // NALs of the access unit, without its AUD. An access unit is complete
+  // once the first NAL of the next one is read: the NALs from
+  // m_auNextStart, which follow its last slice, can start the next one.
+  std::vector<ESENALRange>       m_auRanges;
+  std::vector<ESESlice>          m_auSlices;
+  ESEBuffer                      m_auNextFrame;
+  bool                           m_auHasSlice;
+  size_t                         m_auNextStart;
+  // The NALs of a picture whose first slice is dropped are dropped with it.
+  bool                           m_pictureDropped;
+  // Last H.264 slice read, to find the slices starting a picture.
+  ESEH264SliceHeader             m_lastSlice;
+  bool                           m_lastSliceParsed;
+  // Parameter sets of the NALs read.
+  ESEParameterSets               m_parameterSets;
 };
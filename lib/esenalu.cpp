@@ -18,139 +18,39 @@
 #include "esenalu.h"
 #include "eseutils.h"
 
-const int NAL_UNIT_TYPE_MASK = 0x1F;
-
 const ESEBuffer h264_aud_nalu = { 0x00, 0x00, 0x00, 0x01, 0x09, 0xF0 };
 
 const ESEBuffer h265_aud_nalu = { 0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x10 };
 
-ESENalu::ESENalu (ESEBuffer buffer, ESENaluCodec codec)
-: m_buffer (buffer)
-, m_naluCodec (codec)
-{
-}
-
-ESEH264Nalu::ESEH264Nalu (ESEBuffer buffer)
-: ESENalu (buffer, ESE_NALU_CODEC_H264)
-{
-  parseNalu ();
-}
-
-void
-ESEH264Nalu::parseNalu ()
-{
-  m_naluType = m_buffer[4] & NAL_UNIT_TYPE_MASK;
-
-  switch (m_naluType) {
-    case ESE_H264_NAL_AUD:
-      m_naluCategory = ESE_NALU_CATEGORY_AUD;
-      break;
-    case ESE_H264_NAL_SEI:
-      m_naluCategory = ESE_NALU_CATEGORY_DATA;
-      break;
-    case ESE_H264_NAL_SPS:
-    case ESE_H264_NAL_PPS:
-    case ESE_H264_NAL_SPS_EXT:
-    case ESE_H264_NAL_SUBSET_SPS:
-    case ESE_H264_NAL_DEPTH_SPS:
-      m_naluCategory = ESE_NALU_CATEGORY_PARAMETER_SET;
-      break;
-    case ESE_H264_NAL_SLICE:
-    case ESE_H264_NAL_SLICE_DPA:
-    case ESE_H264_NAL_SLICE_DPB:
-    case ESE_H264_NAL_SLICE_DPC:
-    case ESE_H264_NAL_SLICE_IDR:
-      m_naluCategory = ESE_NALU_CATEGORY_SLICE;
-      break;
-    default:
-      m_naluCategory = ESE_NALU_CATEGORY_UNKNOWN;
-      break;
-  }
-}
-
-ESEH265Nalu::ESEH265Nalu (ESEBuffer buffer)
-: ESENalu (buffer, ESE_NALU_CODEC_H265)
-{
-  parseNalu ();
-}
-
-void
-ESEH265Nalu::parseNalu ()
-{
-  m_naluType = ((m_buffer[4] & 0x7E) >> 1);
-
-  switch (m_naluType) {
-    case ESE_H265_NAL_AUD:
-      m_naluCategory = ESE_NALU_CATEGORY_AUD;
-      break;
-    case ESE_H265_NAL_SPS:
-    case ESE_H265_NAL_PPS:
-    case ESE_H265_NAL_VPS:
-      m_naluCategory = ESE_NALU_CATEGORY_PARAMETER_SET;
-      break;
-    case ESE_H265_NAL_SLICE_TRAIL_N:
-    case ESE_H265_NAL_SLICE_TRAIL_R:
-    case ESE_H265_NAL_SLICE_TSA_N:
-    case ESE_H265_NAL_SLICE_TSA_R:
-    case ESE_H265_NAL_SLICE_STSA_N:
-    case ESE_H265_NAL_SLICE_STSA_R:
-    case ESE_H265_NAL_SLICE_RADL_N:
-    case ESE_H265_NAL_SLICE_RADL_R:
-    case ESE_H265_NAL_SLICE_RASL_N:
-    case ESE_H265_NAL_SLICE_RASL_R:
-    case ESE_H265_NAL_SLICE_BLA_W_LP:
-    case ESE_H265_NAL_SLICE_BLA_W_RADL:
-    case ESE_H265_NAL_SLICE_BLA_N_LP:
-    case ESE_H265_NAL_SLICE_IDR_W_RADL:
-    case ESE_H265_NAL_SLICE_IDR_N_LP:
-    case ESE_H265_NAL_SLICE_CRA_NUT:
-      m_naluCategory = ESE_NALU_CATEGORY_SLICE;
-      break;
-    default:
-      m_naluCategory = ESE_NALU_CATEGORY_UNKNOWN;
-      break;
-  }
-}
-
-static ESENalu *
-getNalu (ESEBuffer buffer, ESENaluCodec codec)
-{
-  ESENalu *nalu;
-  if (!buffer.size ())
-    return nullptr;
-  if (codec == ESE_NALU_CODEC_H264) {
-    nalu = new ESEH264Nalu (buffer);
-  } else {
-    nalu = new ESEH265Nalu (buffer);
-  }
-  return nalu;
-}
-
-ESENaluCategory
-ese_nalu_get_category (ESEBuffer buffer, ESENaluCodec codec)
-{
-  ESENaluCategory cat  = ESE_NALU_CATEGORY_UNKNOWN;
-  ESENalu        *nalu = getNalu (buffer, codec);
-  if (nalu) {
-    cat = nalu->naluCategory ();
-    delete nalu;
-  }
-  return cat;
-}
-
-bool
-ese_is_aud_nalu (ESEBuffer buffer, ESENaluCodec codec)
-{
-  ESENaluCategory cat = ese_nalu_get_category (buffer, codec);
-  return cat == ESE_NALU_CATEGORY_AUD;
-}
-
-bool
-ese_is_new_frame (ESEBuffer buffer, ESENaluCodec codec)
-{
-  ESENaluCategory cat = ese_nalu_get_category (buffer, codec);
-  return (cat >= ESE_NALU_CATEGORY_SLICE);
-}
+constexpr ESENaluCategory ese_h264_nalu_categories[32] = {
+  /*  0 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_SLICE,
+  /*  4 */ ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_DATA, ESE_NALU_CATEGORY_PARAMETER_SET,
+  /*  8 */ ESE_NALU_CATEGORY_PARAMETER_SET, ESE_NALU_CATEGORY_AUD, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 12 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_PARAMETER_SET, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_PARAMETER_SET,
+  /* 16 */ ESE_NALU_CATEGORY_PARAMETER_SET, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 20 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 24 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 28 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+};
+
+constexpr ESENaluCategory ese_h265_nalu_categories[64] = {
+  /*  0 */ ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_SLICE,
+  /*  4 */ ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_SLICE,
+  /*  8 */ ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 12 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 16 */ ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_SLICE,
+  /* 20 */ ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_SLICE, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 24 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 28 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 32 */ ESE_NALU_CATEGORY_PARAMETER_SET, ESE_NALU_CATEGORY_PARAMETER_SET, ESE_NALU_CATEGORY_PARAMETER_SET, ESE_NALU_CATEGORY_AUD,
+  /* 36 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 40 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 44 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 48 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 52 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 56 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+  /* 60 */ ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN, ESE_NALU_CATEGORY_UNKNOWN,
+};
 
 const ESEBuffer &
 ese_aud_nalu (ESENaluCodec codec)
@@ -73,6 +73,8 @@ typedef enum {
   ESE_H265_NAL_SLICE_IDR_W_RADL = 19,
   ESE_H265_NAL_SLICE_IDR_N_LP   = 20,
   ESE_H265_NAL_SLICE_CRA_NUT    = 21,
+  ESE_H265_NAL_RSV_IRAP_22      = 22,
+  ESE_H265_NAL_RSV_IRAP_23      = 23,
   ESE_H265_NAL_VPS              = 32,
   ESE_H265_NAL_SPS              = 33,
   ESE_H265_NAL_PPS              = 34,
@@ -84,53 +86,89 @@ typedef enum {
   ESE_H265_NAL_SUFFIX_SEI       = 40
 } ESEH265NalUnitType;
 
-class ESENalu {
-  public:
-  ESENalu (ESEBuffer buffer, ESENaluCodec codec);
-  virtual ~ESENalu () { }
-
-  int             naluType () { return m_naluType; };
-  ESENaluCodec    naluCodec () { return m_naluCodec; }
-  ESENaluCategory naluCategory () { return m_naluCategory; };
-
-  protected:
-  virtual void    parseNalu () = 0;
-  int             m_naluType;
-  ESEBuffer       m_buffer;
-  ESENaluCodec    m_naluCodec;
-  ESENaluCategory m_naluCategory;
-};
-
-class ESEH264Nalu : public ESENalu {
-  public:
-  ESEH264Nalu (ESEBuffer buffer);
-  virtual ~ESEH264Nalu () { }
-
-  protected:
-  virtual void parseNalu () override;
-};
-
-class ESEH265Nalu : public ESENalu {
-  public:
-  ESEH265Nalu (ESEBuffer buffer);
-  virtual ~ESEH265Nalu () { }
-
-  protected:
-  virtual void parseNalu () override;
-};
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-bool
-ese_is_aud_nalu (ESEBuffer buffer, ESENaluCodec codec);
-bool
-ese_is_new_frame (ESEBuffer buffer, ESENaluCodec codec);
-ESENaluCategory
-ese_nalu_get_category (ESEBuffer buffer, ESENaluCodec codec);
+/// @brief Category of each H.264 nal_unit_type, the 5 low bits of the NAL header.
+extern const ESENaluCategory ese_h264_nalu_categories[32];
+/// @brief Category of each H.265 nal_unit_type, the 6 bits following the
+/// forbidden bit of the NAL header.
+extern const ESENaluCategory ese_h265_nalu_categories[64];
+
+/// @brief Returns the position of the NAL header, after a 3-byte start code
+/// or a 4-byte one, or 0 if the buffer holds no header.
+inline size_t
+ese_nalu_header_position (ESEBufferView buffer)
+{
+  if (buffer.size () < 4)
+    return 0;
+  size_t pos = buffer[2] == 0x01 ? 3 : 4;
+  return pos < buffer.size () ? pos : 0;
+}
+
+inline int
+ese_nalu_header_type (uint8_t header, ESENaluCodec codec)
+{
+  if (codec == ESE_NALU_CODEC_H264)
+    return header & 0x1F;
+  return (header & 0x7E) >> 1;
+}
+
+inline ESENaluCategory
+ese_nalu_header_category (uint8_t header, ESENaluCodec codec)
+{
+  if (codec == ESE_NALU_CODEC_H264)
+    return ese_h264_nalu_categories[ese_nalu_header_type (header, codec)];
+  return ese_h265_nalu_categories[ese_nalu_header_type (header, codec)];
+}
+
+/// @brief Returns the type of the NAL starting with a start code in buffer, or -1.
+inline int
+ese_nalu_get_type (ESEBufferView buffer, ESENaluCodec codec)
+{
+  size_t pos = ese_nalu_header_position (buffer);
+  if (!pos)
+    return -1;
+  return ese_nalu_header_type (buffer[pos], codec);
+}
+
+/// @brief Returns true for an H.264 IDR slice or an H.265 IRAP slice, which
+/// a decoder can start from.
+inline bool
+ese_nalu_type_is_keyframe (int type, ESENaluCodec codec)
+{
+  if (codec == ESE_NALU_CODEC_H264)
+    return type == ESE_H264_NAL_SLICE_IDR;
+  return type >= ESE_H265_NAL_SLICE_BLA_W_LP && type <= ESE_H265_NAL_RSV_IRAP_23;
+}
+
+/// @brief Returns the category of the NAL starting with a start code in buffer.
+inline ESENaluCategory
+ese_nalu_get_category (ESEBufferView buffer, ESENaluCodec codec)
+{
+  size_t pos = ese_nalu_header_position (buffer);
+  if (!pos)
+    return ESE_NALU_CATEGORY_UNKNOWN;
+  return ese_nalu_header_category (buffer[pos], codec);
+}
+
+inline bool
+ese_is_aud_nalu (ESEBufferView buffer, ESENaluCodec codec)
+{
+  return ese_nalu_get_category (buffer, codec) == ESE_NALU_CATEGORY_AUD;
+}
+
+/// @brief Returns true for the non-VCL NAL types which start an access unit
+/// when they follow the last slice of a picture: the AUD, the parameter sets,
+/// the SEI preceding the slices and the reserved types of these positions.
+/// A slice starts an access unit if it starts a new picture.
+inline bool
+ese_nalu_type_starts_access_unit (int type, ESENaluCodec codec)
+{
+  if (type < 0)
+    return false;
+  if (codec == ESE_NALU_CODEC_H264)
+    return (type >= ESE_H264_NAL_SEI && type <= ESE_H264_NAL_AUD) || (type >= ESE_H264_NAL_PREFIX_UNIT && type <= 18);
+  return (type >= ESE_H265_NAL_VPS && type <= ESE_H265_NAL_AUD) || type == ESE_H265_NAL_PREFIX_SEI || (type >= 41 && type <= 44)
+    || (type >= 48 && type <= 55);
+}
+
 const ESEBuffer &
 ese_aud_nalu (ESENaluCodec codec);
-#ifdef __cplusplus
-}
-#endif
\ No newline at end of file
@@ -0,0 +1,202 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+
+#include <new>
+
+#include "eselogger.h"
+#include "esepacketpool.h"
+
+static size_t
+block_size (size_t sizeClass)
+{
+  return static_cast<size_t> (1) << sizeClass;
+}
+
+ESEPacketPool::ESEPacketPool (size_t maxSize)
+: m_cachedSize (0)
+, m_maxSize (maxSize)
+, m_allocFunc (nullptr)
+, m_freeFunc (nullptr)
+, m_allocData (nullptr)
+{
+  for (size_t i = 0; i < ESE_PACKET_POOL_CLASSES; i++)
+    m_freeLists[i] = nullptr;
+}
+
+ESEPacketPool::~ESEPacketPool ()
+{
+  setMaxSize (0);
+}
+
+void
+ESEPacketPool::destroy (ESEPoolPacket *packet)
+{
+  ese_free_func freeFunc = packet->freeFunc;
+  void         *freeData = packet->freeData;
+
+  packet->~ESEPoolPacket ();
+  if (freeFunc)
+    freeFunc (freeData, packet);
+  else
+    ::operator delete (packet);
+}
+
+void
+ESEPacketPool::destroyAll (ESEPoolPacket *packets)
+{
+  while (packets) {
+    ESEPoolPacket *packet = packets;
+    packets               = packet->next;
+    destroy (packet);
+  }
+}
+
+ESEPacket *
+ESEPacketPool::acquire (size_t size)
+{
+  ESEPoolPacket *packet     = nullptr;
+  size_t         sizeClass  = ESE_PACKET_POOL_MIN_CLASS;
+  size_t         block_need = sizeof (ESEPoolPacket) + size;
+  ese_alloc_func allocFunc;
+  ese_free_func  freeFunc;
+  void          *allocData;
+
+  while (sizeClass < ESE_PACKET_POOL_CLASSES - 1 && block_size (sizeClass) < block_need)
+    sizeClass++;
+
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    packet = m_freeLists[sizeClass];
+    if (packet) {
+      m_freeLists[sizeClass] = packet->next;
+      m_cachedSize -= block_size (sizeClass);
+    }
+    allocFunc = m_allocFunc;
+    freeFunc  = m_freeFunc;
+    allocData = m_allocData;
+  }
+  if (!packet) {
+    void *block = allocFunc ? allocFunc (allocData, block_size (sizeClass)) : ::operator new (block_size (sizeClass));
+    if (!block) {
+      ERR ("Unable to allocate a packet block of %zd bytes", block_size (sizeClass));
+      return nullptr;
+    }
+    packet            = new (block) ESEPoolPacket ();
+    packet->sizeClass = sizeClass;
+    packet->freeFunc  = freeFunc;
+    packet->freeData  = allocData;
+    DBG ("Allocate a packet block of %zd bytes", block_size (sizeClass));
+  }
+
+  packet->pool          = shared_from_this ();
+  packet->next          = nullptr;
+  packet->data          = reinterpret_cast<uint8_t *> (packet + 1);
+  packet->data_size     = size;
+  packet->packet_number = 0;
+  packet->pts           = 0;
+  packet->dts           = 0;
+  packet->duration      = 0;
+  return packet;
+}
+
+ESEPacket *
+ESEPacketPool::acquire (const uint8_t *data, size_t size, const std::shared_ptr<const uint8_t> &storage)
+{
+  ESEPoolPacket *packet = static_cast<ESEPoolPacket *> (acquire (0));
+
+  if (!packet)
+    return nullptr;
+  packet->storage   = storage;
+  packet->data      = const_cast<uint8_t *> (data);
+  packet->data_size = size;
+  return packet;
+}
+
+void
+ESEPacketPool::release (ESEPacket *packet)
+{
+  ESEPoolPacket *poolPacket = static_cast<ESEPoolPacket *> (packet);
+
+  poolPacket->storage = nullptr;
+
+  // The pool is destroyed with its last packet once the extractor is gone.
+  std::shared_ptr<ESEPacketPool> pool = std::move (poolPacket->pool);
+  pool->recycle (poolPacket);
+}
+
+void
+ESEPacketPool::recycle (ESEPoolPacket *packet)
+{
+  size_t size = block_size (packet->sizeClass);
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    // A block of a previous allocator is not reused.
+    bool current = packet->freeFunc == m_freeFunc && packet->freeData == m_allocData;
+    if (current && m_cachedSize + size <= m_maxSize) {
+      packet->next                   = m_freeLists[packet->sizeClass];
+      m_freeLists[packet->sizeClass] = packet;
+      m_cachedSize += size;
+      return;
+    }
+  }
+  destroy (packet);
+}
+
+ESEPoolPacket *
+ESEPacketPool::takeCached (size_t maxSize)
+{
+  ESEPoolPacket *dropped = nullptr;
+
+  // Drop the largest blocks first, they are the least likely to be reused.
+  for (size_t i = ESE_PACKET_POOL_CLASSES; i-- > 0 && m_cachedSize > maxSize;) {
+    while (m_freeLists[i] && m_cachedSize > maxSize) {
+      ESEPoolPacket *packet = m_freeLists[i];
+      m_freeLists[i]        = packet->next;
+      packet->next          = dropped;
+      dropped               = packet;
+      m_cachedSize -= block_size (i);
+    }
+  }
+  return dropped;
+}
+
+void
+ESEPacketPool::setMaxSize (size_t maxSize)
+{
+  ESEPoolPacket *dropped;
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_maxSize = maxSize;
+    dropped   = takeCached (maxSize);
+  }
+  destroyAll (dropped);
+}
+
+void
+ESEPacketPool::setAllocator (ese_alloc_func allocFunc, ese_free_func freeFunc, void *data)
+{
+  ESEPoolPacket *dropped;
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_allocFunc = allocFunc;
+    m_freeFunc  = allocFunc ? freeFunc : nullptr;
+    m_allocData = allocFunc ? data : nullptr;
+    dropped     = takeCached (0);
+  }
+  destroyAll (dropped);
+}
@@ -0,0 +1,92 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+#include "esextractor.h"
+
+#define ESE_PACKET_POOL_DEFAULT_SIZE (32 * 1024 * 1024)
+#define ESE_PACKET_POOL_MIN_CLASS 8
+#define ESE_PACKET_POOL_CLASSES (8 * sizeof (size_t))
+
+class ESEPacketPool;
+
+/// @brief Packet allocated by ESEPacketPool. The payload follows the
+/// structure in the same block.
+struct ESEPoolPacket : public ESEPacket {
+  std::shared_ptr<ESEPacketPool> pool;
+  // Memory of a borrowed payload, kept until the packet is released.
+  std::shared_ptr<const uint8_t> storage;
+  ESEPoolPacket                 *next;
+  size_t                         sizeClass;
+  // Frees the block, or operator delete if null.
+  ese_free_func                  freeFunc;
+  void                          *freeData;
+};
+
+/// @brief Recycles the packets of an extractor.
+/// A packet and its payload are allocated in a single block whose size is
+/// rounded up to a power of two. The released blocks are kept in one freelist
+/// per size class, up to maxSize bytes, so a steady stream of packets does not
+/// allocate. The packets keep the pool alive, they can be released after the
+/// extractor teardown or from another thread.
+/// The blocks are allocated with operator new, or with the allocator of the
+/// application once set.
+class ESEPacketPool : public std::enable_shared_from_this<ESEPacketPool> {
+  public:
+  ESEPacketPool (size_t maxSize = ESE_PACKET_POOL_DEFAULT_SIZE);
+  ~ESEPacketPool ();
+
+  /// @brief Returns a packet with room for size bytes of payload.
+  ESEPacket *acquire (size_t size);
+  /// @brief Returns a packet pointing to size bytes of data, which stays
+  /// valid as the packet holds a reference on its storage until released.
+  ESEPacket *acquire (const uint8_t *data, size_t size, const std::shared_ptr<const uint8_t> &storage);
+  /// @brief Gives a packet back to the pool it was acquired from.
+  static void release (ESEPacket *packet);
+
+  /// @brief Sets the amount of memory kept for reuse, 0 disables the recycling.
+  void   setMaxSize (size_t maxSize);
+  /// @brief Allocates the next blocks with allocFunc, or with operator new if
+  /// null. The cached blocks are freed, the packets in use are freed on release
+  /// with the function they were allocated with.
+  void   setAllocator (ese_alloc_func allocFunc, ese_free_func freeFunc, void *data);
+  size_t maxSize () { return m_maxSize; }
+  size_t cachedSize () { return m_cachedSize; }
+
+  private:
+  ESEPacketPool (const ESEPacketPool &);
+  ESEPacketPool &operator= (const ESEPacketPool &);
+
+  void           recycle (ESEPoolPacket *packet);
+  ESEPoolPacket *takeCached (size_t maxSize);
+  static void    destroy (ESEPoolPacket *packet);
+  static void    destroyAll (ESEPoolPacket *packets);
+
+  std::mutex     m_mutex;
+  ESEPoolPacket *m_freeLists[ESE_PACKET_POOL_CLASSES];
+  size_t         m_cachedSize;
+  size_t         m_maxSize;
+  ese_alloc_func m_allocFunc;
+  ese_free_func  m_freeFunc;
+  void          *m_allocData;
+};
@@ -0,0 +1,658 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include "eseparamsets.h"
+#include "esebitreader.h"
+#include "eselogger.h"
+
+// Limits of the ids and tables of the specifications.
+#define H264_MAX_SPS_ID 31
+#define H264_MAX_PPS_ID 255
+#define H264_MAX_SIZE_IN_MBS 4096
+#define H265_MAX_VPS_ID 15
+#define H265_MAX_SPS_ID 15
+#define H265_MAX_PPS_ID 63
+#define H265_MAX_SHORT_TERM_REF_PIC_SETS 64
+#define H265_MAX_DELTA_POCS 16
+
+/// @brief Delta POCs of an H.265 short term reference picture set.
+struct H265ShortTermRefPicSet {
+  std::vector<int32_t> negative;
+  std::vector<int32_t> positive;
+};
+
+static void
+skip_h264_scaling_list (ESEBitReader &reader, int size)
+{
+  int32_t last_scale = 8;
+  int32_t next_scale = 8;
+
+  for (int i = 0; i < size && reader.isValid (); i++) {
+    if (next_scale)
+      next_scale = (last_scale + reader.readSE () + 256) % 256;
+    if (next_scale)
+      last_scale = next_scale;
+  }
+}
+
+/// @brief Returns true if the SPS of the profile holds its chroma format and bit depths.
+static bool
+h264_profile_has_chroma_format (uint32_t profile_idc)
+{
+  static const uint32_t profiles[] = { 100, 110, 122, 244, 44, 83, 86, 118, 128, 138, 139, 134, 135 };
+  return std::find (std::begin (profiles), std::end (profiles), profile_idc) != std::end (profiles);
+}
+
+static void
+parse_h264_vui (ESEBitReader &reader, ESEVUITiming *timing)
+{
+  // aspect_ratio_idc 255 is followed by the sample aspect ratio.
+  if (reader.readFlag () && reader.readBits (8) == 255)
+    reader.skipBits (32);
+  // overscan_appropriate_flag
+  if (reader.readFlag ())
+    reader.skipBits (1);
+  // video_format, video_full_range_flag and the colour description.
+  if (reader.readFlag ()) {
+    reader.skipBits (4);
+    if (reader.readFlag ())
+      reader.skipBits (24);
+  }
+  // chroma_sample_loc_type_top_field and bottom_field
+  if (reader.readFlag ()) {
+    reader.readUE ();
+    reader.readUE ();
+  }
+  if (reader.readFlag ()) {
+    timing->num_units_in_tick = reader.readBits (32);
+    timing->time_scale        = reader.readBits (32);
+  }
+}
+
+bool
+ESEParameterSets::parseH264Sps (ESEBufferView payload)
+{
+  ESEBitReader reader (payload);
+  ESEH264SPS   sps = {};
+
+  sps.profile_idc = reader.readBits (8);
+  // constraint_set flags and reserved_zero_2bits
+  reader.skipBits (8);
+  sps.level_idc = reader.readBits (8);
+  uint32_t id   = reader.readUE ();
+  if (id > H264_MAX_SPS_ID)
+    return false;
+
+  sps.chroma_format_idc = 1;
+  sps.bit_depth_luma    = 8;
+  sps.bit_depth_chroma  = 8;
+  if (h264_profile_has_chroma_format (sps.profile_idc)) {
+    sps.chroma_format_idc = reader.readUE ();
+    if (sps.chroma_format_idc > 3)
+      return false;
+    if (sps.chroma_format_idc == 3)
+      sps.separate_colour_plane_flag = reader.readFlag ();
+    sps.bit_depth_luma   = reader.readUE () + 8;
+    sps.bit_depth_chroma = reader.readUE () + 8;
+    // qpprime_y_zero_transform_bypass_flag
+    reader.skipBits (1);
+    if (reader.readFlag ()) {
+      for (int i = 0; i < (sps.chroma_format_idc != 3 ? 8 : 12); i++) {
+        if (reader.readFlag ())
+          skip_h264_scaling_list (reader, i < 6 ? 16 : 64);
+      }
+    }
+  }
+  if (sps.bit_depth_luma > 14 || sps.bit_depth_chroma > 14)
+    return false;
+  sps.log2_max_frame_num = reader.readUE () + 4;
+  if (sps.log2_max_frame_num > 16)
+    return false;
+  sps.pic_order_cnt_type = reader.readUE ();
+  if (sps.pic_order_cnt_type == 0) {
+    sps.log2_max_pic_order_cnt_lsb = reader.readUE () + 4;
+    if (sps.log2_max_pic_order_cnt_lsb > 16)
+      return false;
+  } else if (sps.pic_order_cnt_type == 1) {
+    sps.delta_pic_order_always_zero_flag = reader.readFlag ();
+    // offset_for_non_ref_pic and offset_for_top_to_bottom_field
+    reader.readSE ();
+    reader.readSE ();
+    uint32_t cycle = reader.readUE ();
+    if (cycle > 255)
+      return false;
+    for (uint32_t i = 0; i < cycle; i++)
+      reader.readSE ();
+  }
+  // max_num_ref_frames and gaps_in_frame_num_value_allowed_flag
+  reader.readUE ();
+  reader.skipBits (1);
+  uint32_t width_in_mbs   = reader.readUE () + 1;
+  uint32_t height_in_map  = reader.readUE () + 1;
+  sps.frame_mbs_only_flag = reader.readFlag ();
+  if (width_in_mbs > H264_MAX_SIZE_IN_MBS || height_in_map > H264_MAX_SIZE_IN_MBS)
+    return false;
+  // mb_adaptive_frame_field_flag
+  if (!sps.frame_mbs_only_flag)
+    reader.skipBits (1);
+  // direct_8x8_inference_flag
+  reader.skipBits (1);
+  uint32_t frame_height = (sps.frame_mbs_only_flag ? 1 : 2) * height_in_map * 16;
+  sps.width             = width_in_mbs * 16;
+  sps.height            = frame_height;
+  if (reader.readFlag ()) {
+    // The cropping is in chroma samples, and in field pairs for the fields.
+    uint32_t chroma_type = sps.separate_colour_plane_flag ? 0 : sps.chroma_format_idc;
+    uint32_t crop_x      = chroma_type == 1 || chroma_type == 2 ? 2 : 1;
+    uint32_t crop_y      = (chroma_type == 1 ? 2 : 1) * (sps.frame_mbs_only_flag ? 1 : 2);
+    uint32_t left        = reader.readUE ();
+    uint32_t right       = reader.readUE ();
+    uint32_t top         = reader.readUE ();
+    uint32_t bottom      = reader.readUE ();
+    if ((static_cast<uint64_t> (left) + right) * crop_x >= sps.width || (static_cast<uint64_t> (top) + bottom) * crop_y >= sps.height)
+      return false;
+    sps.width -= (left + right) * crop_x;
+    sps.height -= (top + bottom) * crop_y;
+  }
+  if (reader.readFlag ())
+    parse_h264_vui (reader, &sps.timing);
+  if (!reader.isValid ())
+    return false;
+
+  m_h264Sps[id] = sps;
+  m_lastSpsId   = id;
+  DBG ("Found the H.264 SPS %u of %ux%u, profile %u level %u", id, sps.width, sps.height, sps.profile_idc, sps.level_idc);
+  return true;
+}
+
+bool
+ESEParameterSets::parseH264Pps (ESEBufferView payload)
+{
+  ESEBitReader reader (payload);
+  ESEH264PPS   pps = {};
+
+  uint32_t id = reader.readUE ();
+  pps.sps_id  = reader.readUE ();
+  // entropy_coding_mode_flag
+  reader.skipBits (1);
+  pps.bottom_field_pic_order_in_frame_present_flag = reader.readFlag ();
+  if (!reader.isValid () || id > H264_MAX_PPS_ID || pps.sps_id > H264_MAX_SPS_ID)
+    return false;
+  m_h264Pps[id] = pps;
+  return true;
+}
+
+static void
+parse_h265_profile_tier_level (ESEBitReader &reader, uint32_t max_sub_layers, uint32_t *profile_idc, uint32_t *level_idc)
+{
+  bool sub_layer_profile_present[8];
+  bool sub_layer_level_present[8];
+
+  // general_profile_space and general_tier_flag
+  reader.skipBits (3);
+  *profile_idc = reader.readBits (5);
+  // The compatibility flags, the source and constraint flags.
+  reader.skipBits (32 + 48);
+  *level_idc = reader.readBits (8);
+  for (uint32_t i = 0; i + 1 < max_sub_layers; i++) {
+    sub_layer_profile_present[i] = reader.readFlag ();
+    sub_layer_level_present[i]   = reader.readFlag ();
+  }
+  if (max_sub_layers > 1)
+    reader.skipBits (2 * (9 - max_sub_layers));
+  for (uint32_t i = 0; i + 1 < max_sub_layers; i++) {
+    if (sub_layer_profile_present[i])
+      reader.skipBits (88);
+    if (sub_layer_level_present[i])
+      reader.skipBits (8);
+  }
+}
+
+bool
+ESEParameterSets::parseH265Vps (ESEBufferView payload)
+{
+  ESEBitReader reader (payload);
+  ESEH265VPS   vps = {};
+
+  uint32_t id = reader.readBits (4);
+  // vps_base_layer_internal_flag, vps_base_layer_available_flag and vps_max_layers_minus1
+  reader.skipBits (8);
+  vps.max_sub_layers = reader.readBits (3) + 1;
+  // vps_temporal_id_nesting_flag and vps_reserved_0xffff_16bits
+  reader.skipBits (17);
+  if (vps.max_sub_layers > 7)
+    return false;
+  parse_h265_profile_tier_level (reader, vps.max_sub_layers, &vps.general_profile_idc, &vps.general_level_idc);
+  if (!reader.isValid ())
+    return false;
+  m_h265Vps[id] = vps;
+  return true;
+}
+
+static void
+skip_h265_scaling_list_data (ESEBitReader &reader)
+{
+  for (int size_id = 0; size_id < 4; size_id++) {
+    for (int matrix_id = 0; matrix_id < 6; matrix_id += size_id == 3 ? 3 : 1) {
+      // scaling_list_pred_mode_flag, then scaling_list_pred_matrix_id_delta
+      // or the coefficients.
+      if (!reader.readFlag ()) {
+        reader.readUE ();
+        continue;
+      }
+      int coef_count = size_id ? 64 : 16;
+      if (size_id > 1)
+        reader.readSE ();
+      for (int i = 0; i < coef_count && reader.isValid (); i++)
+        reader.readSE ();
+    }
+  }
+}
+
+static bool
+parse_h265_short_term_ref_pic_set (ESEBitReader &reader, uint32_t index, uint32_t count, std::vector<H265ShortTermRefPicSet> &sets)
+{
+  H265ShortTermRefPicSet &set = sets[index];
+
+  if (index && reader.readFlag ()) {
+    // inter_ref_pic_set_prediction_flag: the set is predicted from a previous
+    // one, of which each delta POC is kept or not.
+    uint32_t delta_index = index == count ? reader.readUE () + 1 : 1;
+    if (delta_index > index)
+      return false;
+    bool                          negative_delta = reader.readFlag ();
+    int32_t                       delta_rps      = static_cast<int32_t> (reader.readUE () + 1) * (negative_delta ? -1 : 1);
+    const H265ShortTermRefPicSet &ref            = sets[index - delta_index];
+    size_t                        ref_count      = ref.negative.size () + ref.positive.size ();
+    std::vector<bool>             use_delta (ref_count + 1);
+    for (size_t j = 0; j <= ref_count; j++) {
+      // use_delta_flag is only coded when used_by_curr_pic_flag is 0.
+      use_delta[j] = reader.readFlag () || reader.readFlag ();
+    }
+    for (size_t j = ref.positive.size (); j-- > 0;) {
+      int32_t poc = ref.positive[j] + delta_rps;
+      if (poc < 0 && use_delta[ref.negative.size () + j])
+        set.negative.push_back (poc);
+    }
+    if (delta_rps < 0 && use_delta[ref_count])
+      set.negative.push_back (delta_rps);
+    for (size_t j = 0; j < ref.negative.size (); j++) {
+      int32_t poc = ref.negative[j] + delta_rps;
+      if (poc < 0 && use_delta[j])
+        set.negative.push_back (poc);
+    }
+    for (size_t j = ref.negative.size (); j-- > 0;) {
+      int32_t poc = ref.negative[j] + delta_rps;
+      if (poc > 0 && use_delta[j])
+        set.positive.push_back (poc);
+    }
+    if (delta_rps > 0 && use_delta[ref_count])
+      set.positive.push_back (delta_rps);
+    for (size_t j = 0; j < ref.positive.size (); j++) {
+      int32_t poc = ref.positive[j] + delta_rps;
+      if (poc > 0 && use_delta[ref.negative.size () + j])
+        set.positive.push_back (poc);
+    }
+  } else {
+    uint32_t negative_count = reader.readUE ();
+    uint32_t positive_count = reader.readUE ();
+    int32_t  poc            = 0;
+    if (negative_count > H265_MAX_DELTA_POCS || positive_count > H265_MAX_DELTA_POCS)
+      return false;
+    // delta_poc_s0_minus1 or delta_poc_s1_minus1, then used_by_curr_pic_s0_flag or s1.
+    for (uint32_t i = 0; i < negative_count; i++) {
+      poc -= static_cast<int32_t> (reader.readUE () + 1);
+      reader.skipBits (1);
+      set.negative.push_back (poc);
+    }
+    poc = 0;
+    for (uint32_t i = 0; i < positive_count; i++) {
+      poc += static_cast<int32_t> (reader.readUE () + 1);
+      reader.skipBits (1);
+      set.positive.push_back (poc);
+    }
+  }
+  return set.negative.size () + set.positive.size () <= H265_MAX_DELTA_POCS && reader.isValid ();
+}
+
+static void
+parse_h265_vui (ESEBitReader &reader, ESEVUITiming *timing)
+{
+  if (reader.readFlag () && reader.readBits (8) == 255)
+    reader.skipBits (32);
+  if (reader.readFlag ())
+    reader.skipBits (1);
+  if (reader.readFlag ()) {
+    reader.skipBits (4);
+    if (reader.readFlag ())
+      reader.skipBits (24);
+  }
+  if (reader.readFlag ()) {
+    reader.readUE ();
+    reader.readUE ();
+  }
+  // neutral_chroma_indication_flag, field_seq_flag and frame_field_info_present_flag
+  reader.skipBits (3);
+  // The default display window offsets.
+  if (reader.readFlag ()) {
+    for (int i = 0; i < 4; i++)
+      reader.readUE ();
+  }
+  if (reader.readFlag ()) {
+    timing->num_units_in_tick = reader.readBits (32);
+    timing->time_scale        = reader.readBits (32);
+  }
+}
+
+bool
+ESEParameterSets::parseH265Sps (ESEBufferView payload)
+{
+  ESEBitReader reader (payload);
+  ESEH265SPS   sps = {};
+
+  sps.vps_id         = reader.readBits (4);
+  sps.max_sub_layers = reader.readBits (3) + 1;
+  // sps_temporal_id_nesting_flag
+  reader.skipBits (1);
+  if (sps.max_sub_layers > 7)
+    return false;
+  parse_h265_profile_tier_level (reader, sps.max_sub_layers, &sps.general_profile_idc, &sps.general_level_idc);
+  uint32_t id           = reader.readUE ();
+  sps.chroma_format_idc = reader.readUE ();
+  if (id > H265_MAX_SPS_ID || sps.chroma_format_idc > 3)
+    return false;
+  if (sps.chroma_format_idc == 3)
+    sps.separate_colour_plane_flag = reader.readFlag ();
+  sps.width  = reader.readUE ();
+  sps.height = reader.readUE ();
+  if (reader.readFlag ()) {
+    // The conformance window is in chroma samples.
+    uint32_t chroma_type = sps.separate_colour_plane_flag ? 0 : sps.chroma_format_idc;
+    uint32_t crop_x      = chroma_type == 1 || chroma_type == 2 ? 2 : 1;
+    uint32_t crop_y      = chroma_type == 1 ? 2 : 1;
+    uint32_t left        = reader.readUE ();
+    uint32_t right       = reader.readUE ();
+    uint32_t top         = reader.readUE ();
+    uint32_t bottom      = reader.readUE ();
+    if ((static_cast<uint64_t> (left) + right) * crop_x >= sps.width || (static_cast<uint64_t> (top) + bottom) * crop_y >= sps.height)
+      return false;
+    sps.width -= (left + right) * crop_x;
+    sps.height -= (top + bottom) * crop_y;
+  }
+  sps.bit_depth_luma             = reader.readUE () + 8;
+  sps.bit_depth_chroma           = reader.readUE () + 8;
+  sps.log2_max_pic_order_cnt_lsb = reader.readUE () + 4;
+  if (sps.bit_depth_luma > 16 || sps.bit_depth_chroma > 16 || sps.log2_max_pic_order_cnt_lsb > 16)
+    return false;
+  // sps_max_dec_pic_buffering_minus1, sps_max_num_reorder_pics and
+  // sps_max_latency_increase_plus1 of each sub-layer, or of the highest one.
+  for (uint32_t i = reader.readFlag () ? 0 : sps.max_sub_layers - 1; i < sps.max_sub_layers; i++) {
+    reader.readUE ();
+    reader.readUE ();
+    reader.readUE ();
+  }
+  // The coding and transform block sizes and the transform hierarchy depths.
+  for (int i = 0; i < 6; i++)
+    reader.readUE ();
+  // scaling_list_enabled_flag, then sps_scaling_list_data_present_flag.
+  if (reader.readFlag () && reader.readFlag ())
+    skip_h265_scaling_list_data (reader);
+  // amp_enabled_flag and sample_adaptive_offset_enabled_flag
+  reader.skipBits (2);
+  if (reader.readFlag ()) {
+    // The PCM sample bit depths, log2_min_pcm_luma_coding_block_size_minus3,
+    // log2_diff_max_min_pcm_luma_coding_block_size and pcm_loop_filter_disabled_flag.
+    reader.skipBits (8);
+    reader.readUE ();
+    reader.readUE ();
+    reader.skipBits (1);
+  }
+  uint32_t set_count = reader.readUE ();
+  if (set_count > H265_MAX_SHORT_TERM_REF_PIC_SETS)
+    return false;
+  std::vector<H265ShortTermRefPicSet> sets (set_count);
+  for (uint32_t i = 0; i < set_count; i++) {
+    if (!parse_h265_short_term_ref_pic_set (reader, i, set_count, sets))
+      return false;
+  }
+  if (reader.readFlag ()) {
+    // lt_ref_pic_poc_lsb_sps and used_by_curr_pic_lt_sps_flag
+    uint32_t long_term_count = reader.readUE ();
+    if (long_term_count > 32)
+      return false;
+    reader.skipBits (long_term_count * (sps.log2_max_pic_order_cnt_lsb + 1));
+  }
+  // sps_temporal_mvp_enabled_flag and strong_intra_smoothing_enabled_flag
+  reader.skipBits (2);
+  if (reader.readFlag ())
+    parse_h265_vui (reader, &sps.timing);
+  if (!reader.isValid ())
+    return false;
+
+  m_h265Sps[id] = sps;
+  m_lastSpsId   = id;
+  DBG ("Found the H.265 SPS %u of %ux%u, profile %u level %u", id, sps.width, sps.height, sps.general_profile_idc, sps.general_level_idc);
+  return true;
+}
+
+bool
+ESEParameterSets::parseH265Pps (ESEBufferView payload)
+{
+  ESEBitReader reader (payload);
+  ESEH265PPS   pps = {};
+
+  uint32_t id                               = reader.readUE ();
+  pps.sps_id                                = reader.readUE ();
+  pps.dependent_slice_segments_enabled_flag = reader.readFlag ();
+  // output_flag_present_flag
+  reader.skipBits (1);
+  pps.num_extra_slice_header_bits = reader.readBits (3);
+  if (!reader.isValid () || id > H265_MAX_PPS_ID || pps.sps_id > H265_MAX_SPS_ID)
+    return false;
+  m_h265Pps[id] = pps;
+  return true;
+}
+
+ESEParameterSets::ESEParameterSets ()
+{
+  reset ();
+}
+
+void
+ESEParameterSets::reset ()
+{
+  m_codec = ESE_NALU_CODEC_UNKNOWN;
+  m_lastNals.clear ();
+  m_h264Sps.clear ();
+  m_h264Pps.clear ();
+  m_h265Vps.clear ();
+  m_h265Sps.clear ();
+  m_h265Pps.clear ();
+  m_lastSpsId = -1;
+}
+
+bool
+ESEParameterSets::update (ESEBufferView nal, ESENaluCodec codec)
+{
+  size_t pos  = ese_nalu_header_position (nal);
+  int    type = ese_nalu_get_type (nal, codec);
+  bool   parsed;
+
+  if (!pos || (type != ESE_H264_NAL_SPS && type != ESE_H264_NAL_PPS && codec == ESE_NALU_CODEC_H264)
+    || (type != ESE_H265_NAL_VPS && type != ESE_H265_NAL_SPS && type != ESE_H265_NAL_PPS && codec == ESE_NALU_CODEC_H265))
+    return true;
+  m_codec = codec;
+  // The payload follows the NAL header, of 1 byte in H.264 and 2 in H.265.
+  ESEBufferView header = nal.subView (pos, nal.size ());
+  ESEBuffer    &last   = m_lastNals[type];
+  if (last.size () == header.size () && std::equal (header.begin (), header.end (), last.begin ()))
+    return true;
+
+  if (codec == ESE_NALU_CODEC_H264) {
+    ESEBufferView payload = header.subView (1, header.size ());
+    parsed                = type == ESE_H264_NAL_SPS ? parseH264Sps (payload) : parseH264Pps (payload);
+  } else {
+    ESEBufferView payload = header.subView (2, header.size ());
+    if (type == ESE_H265_NAL_VPS)
+      parsed = parseH265Vps (payload);
+    else if (type == ESE_H265_NAL_SPS)
+      parsed = parseH265Sps (payload);
+    else
+      parsed = parseH265Pps (payload);
+  }
+  if (!parsed) {
+    ERR ("Unable to parse the parameter set NAL of type %d and size %zd", type, nal.size ());
+    last.clear ();
+    return false;
+  }
+  last.assign (header.begin (), header.end ());
+  return true;
+}
+
+bool
+ESEParameterSets::streamInfo (ESEStreamInfo *info)
+{
+  if (m_lastSpsId < 0)
+    return false;
+  *info = ESEStreamInfo ();
+  if (m_codec == ESE_NALU_CODEC_H264) {
+    const ESEH264SPS &sps   = m_h264Sps[static_cast<uint32_t> (m_lastSpsId)];
+    info->codec             = ESE_VIDEO_CODEC_H264;
+    info->width             = sps.width;
+    info->height            = sps.height;
+    info->profile           = sps.profile_idc;
+    info->level             = sps.level_idc;
+    info->chroma_format     = sps.chroma_format_idc;
+    info->bit_depth_luma    = sps.bit_depth_luma;
+    info->bit_depth_chroma  = sps.bit_depth_chroma;
+    info->num_units_in_tick = sps.timing.num_units_in_tick;
+    info->time_scale        = sps.timing.time_scale;
+  } else {
+    const ESEH265SPS &sps   = m_h265Sps[static_cast<uint32_t> (m_lastSpsId)];
+    info->codec             = ESE_VIDEO_CODEC_H265;
+    info->width             = sps.width;
+    info->height            = sps.height;
+    info->profile           = sps.general_profile_idc;
+    info->level             = sps.general_level_idc;
+    info->chroma_format     = sps.chroma_format_idc;
+    info->bit_depth_luma    = sps.bit_depth_luma;
+    info->bit_depth_chroma  = sps.bit_depth_chroma;
+    info->num_units_in_tick = sps.timing.num_units_in_tick;
+    info->time_scale        = sps.timing.time_scale;
+  }
+  return true;
+}
+
+bool
+ESEParameterSets::parseH264SliceHeader (ESEBufferView nal, ESEH264SliceHeader *header)
+{
+  size_t pos = ese_nalu_header_position (nal);
+
+  *header = ESEH264SliceHeader ();
+  if (!pos)
+    return false;
+  ESEBitReader reader (nal.subView (pos + 1, nal.size ()));
+  header->nal_ref_idc       = (nal[pos] >> 5) & 0x3;
+  header->idr_pic_flag      = (nal[pos] & 0x1F) == ESE_H264_NAL_SLICE_IDR;
+  header->first_mb_in_slice = reader.readUE ();
+  // slice_type
+  reader.readUE ();
+  header->pps_id        = reader.readUE ();
+  const ESEH264PPS *pps = h264Pps (header->pps_id);
+  const ESEH264SPS *sps = pps ? h264Sps (pps->sps_id) : nullptr;
+  if (!sps || !reader.isValid ())
+    return false;
+  // colour_plane_id
+  if (sps->separate_colour_plane_flag)
+    reader.skipBits (2);
+  header->frame_num = reader.readBits (sps->log2_max_frame_num);
+  if (!sps->frame_mbs_only_flag) {
+    header->field_pic_flag = reader.readFlag ();
+    if (header->field_pic_flag)
+      header->bottom_field_flag = reader.readFlag ();
+  }
+  if (header->idr_pic_flag)
+    header->idr_pic_id = reader.readUE ();
+  header->pic_order_cnt_type = sps->pic_order_cnt_type;
+  if (sps->pic_order_cnt_type == 0) {
+    header->pic_order_cnt_lsb = reader.readBits (sps->log2_max_pic_order_cnt_lsb);
+    if (pps->bottom_field_pic_order_in_frame_present_flag && !header->field_pic_flag)
+      header->delta_pic_order_cnt_bottom = reader.readSE ();
+  } else if (sps->pic_order_cnt_type == 1 && !sps->delta_pic_order_always_zero_flag) {
+    header->delta_pic_order_cnt[0] = reader.readSE ();
+    if (pps->bottom_field_pic_order_in_frame_present_flag && !header->field_pic_flag)
+      header->delta_pic_order_cnt[1] = reader.readSE ();
+  }
+  return reader.isValid ();
+}
+
+bool
+ese_h264_is_new_picture (const ESEH264SliceHeader &previous, const ESEH264SliceHeader &current)
+{
+  // The slices may be in an arbitrary order, the first one of a picture not
+  // starting with its first macroblock.
+  return current.frame_num != previous.frame_num || current.pps_id != previous.pps_id
+    || current.field_pic_flag != previous.field_pic_flag || current.bottom_field_flag != previous.bottom_field_flag
+    || (current.nal_ref_idc != previous.nal_ref_idc && (!current.nal_ref_idc || !previous.nal_ref_idc))
+    || (current.pic_order_cnt_type == 0
+      && (current.pic_order_cnt_lsb != previous.pic_order_cnt_lsb || current.delta_pic_order_cnt_bottom != previous.delta_pic_order_cnt_bottom))
+    || (current.pic_order_cnt_type == 1
+      && (current.delta_pic_order_cnt[0] != previous.delta_pic_order_cnt[0] || current.delta_pic_order_cnt[1] != previous.delta_pic_order_cnt[1]))
+    || current.idr_pic_flag != previous.idr_pic_flag || (current.idr_pic_flag && current.idr_pic_id != previous.idr_pic_id);
+}
+
+template <typename T>
+static const T *
+find_parameter_set (const std::map<uint32_t, T> &sets, uint32_t id)
+{
+  typename std::map<uint32_t, T>::const_iterator it = sets.find (id);
+  return it == sets.end () ? nullptr : &it->second;
+}
+
+const ESEH264SPS *
+ESEParameterSets::h264Sps (uint32_t id)
+{
+  return find_parameter_set (m_h264Sps, id);
+}
+
+const ESEH264PPS *
+ESEParameterSets::h264Pps (uint32_t id)
+{
+  return find_parameter_set (m_h264Pps, id);
+}
+
+const ESEH265VPS *
+ESEParameterSets::h265Vps (uint32_t id)
+{
+  return find_parameter_set (m_h265Vps, id);
+}
+
+const ESEH265SPS *
+ESEParameterSets::h265Sps (uint32_t id)
+{
+  return find_parameter_set (m_h265Sps, id);
+}
+
+const ESEH265PPS *
+ESEParameterSets::h265Pps (uint32_t id)
+{
+  return find_parameter_set (m_h265Pps, id);
+}
@@ -0,0 +1,148 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <map>
+
+#include "esenalu.h"
+#include "esextractor.h"
+
+/// @brief VUI timing of a sequence parameter set, 0 when absent.
+struct ESEVUITiming {
+  uint32_t num_units_in_tick;
+  uint32_t time_scale;
+};
+
+struct ESEH264SPS {
+  uint32_t     profile_idc;
+  uint32_t     level_idc;
+  uint32_t     chroma_format_idc;
+  bool         separate_colour_plane_flag;
+  uint32_t     bit_depth_luma;
+  uint32_t     bit_depth_chroma;
+  uint32_t     log2_max_frame_num;
+  uint32_t     pic_order_cnt_type;
+  uint32_t     log2_max_pic_order_cnt_lsb;
+  bool         delta_pic_order_always_zero_flag;
+  bool         frame_mbs_only_flag;
+  // Size of the pictures, after the cropping window.
+  uint32_t     width;
+  uint32_t     height;
+  ESEVUITiming timing;
+};
+
+struct ESEH264PPS {
+  uint32_t sps_id;
+  bool     bottom_field_pic_order_in_frame_present_flag;
+};
+
+struct ESEH265VPS {
+  uint32_t max_sub_layers;
+  uint32_t general_profile_idc;
+  uint32_t general_level_idc;
+};
+
+struct ESEH265SPS {
+  uint32_t     vps_id;
+  uint32_t     max_sub_layers;
+  uint32_t     general_profile_idc;
+  uint32_t     general_level_idc;
+  uint32_t     chroma_format_idc;
+  bool         separate_colour_plane_flag;
+  uint32_t     bit_depth_luma;
+  uint32_t     bit_depth_chroma;
+  uint32_t     log2_max_pic_order_cnt_lsb;
+  // Size of the pictures, after the conformance window.
+  uint32_t     width;
+  uint32_t     height;
+  ESEVUITiming timing;
+};
+
+struct ESEH265PPS {
+  uint32_t sps_id;
+  bool     dependent_slice_segments_enabled_flag;
+  uint32_t num_extra_slice_header_bits;
+};
+
+/// @brief Start of an H.264 slice header, with the fields which tell the
+/// pictures apart.
+struct ESEH264SliceHeader {
+  uint32_t nal_ref_idc;
+  bool     idr_pic_flag;
+  uint32_t first_mb_in_slice;
+  uint32_t pps_id;
+  uint32_t frame_num;
+  bool     field_pic_flag;
+  bool     bottom_field_flag;
+  uint32_t idr_pic_id;
+  uint32_t pic_order_cnt_type;
+  uint32_t pic_order_cnt_lsb;
+  int32_t  delta_pic_order_cnt_bottom;
+  int32_t  delta_pic_order_cnt[2];
+};
+
+/// @brief Returns true if the slice of current starts a new primary coded
+/// picture, following the slice of previous.
+bool
+ese_h264_is_new_picture (const ESEH264SliceHeader &previous, const ESEH264SliceHeader &current);
+
+/// @brief Parameter sets of an H.264 or H.265 stream, by id.
+/// A parameter set NAL is only parsed when it differs from the last one of
+/// its type, as the streams repeat them before their key frames.
+class ESEParameterSets {
+  public:
+  ESEParameterSets ();
+
+  void reset ();
+  /// @brief Parses the SPS, PPS or VPS NAL starting with a start code, the
+  /// other NALs are ignored.
+  /// @return false if the parameter set can not be parsed.
+  bool update (ESEBufferView nal, ESENaluCodec codec);
+  /// @brief Describes the stream from the last sequence parameter set.
+  /// @return false if none has been parsed yet.
+  bool streamInfo (ESEStreamInfo *info);
+  /// @brief Parses the start of the header of the H.264 slice NAL starting
+  /// with a start code, up to its picture order count.
+  /// @return false if only first_mb_in_slice could be read, its parameter
+  /// sets being unknown or the NAL too short.
+  bool parseH264SliceHeader (ESEBufferView nal, ESEH264SliceHeader *header);
+
+  const ESEH264SPS *h264Sps (uint32_t id);
+  const ESEH264PPS *h264Pps (uint32_t id);
+  const ESEH265VPS *h265Vps (uint32_t id);
+  const ESEH265SPS *h265Sps (uint32_t id);
+  const ESEH265PPS *h265Pps (uint32_t id);
+
+  private:
+  bool parseH264Sps (ESEBufferView payload);
+  bool parseH264Pps (ESEBufferView payload);
+  bool parseH265Vps (ESEBufferView payload);
+  bool parseH265Sps (ESEBufferView payload);
+  bool parseH265Pps (ESEBufferView payload);
+
+  ESENaluCodec                     m_codec;
+  // Last NAL parsed of each type, with its header.
+  std::map<int, ESEBuffer>         m_lastNals;
+  std::map<uint32_t, ESEH264SPS>   m_h264Sps;
+  std::map<uint32_t, ESEH264PPS>   m_h264Pps;
+  std::map<uint32_t, ESEH265VPS>   m_h265Vps;
+  std::map<uint32_t, ESEH265SPS>   m_h265Sps;
+  std::map<uint32_t, ESEH265PPS>   m_h265Pps;
+  // Id of the last sequence parameter set parsed, -1 before the first one.
+  int64_t                          m_lastSpsId;
+};
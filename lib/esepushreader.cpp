@@ -0,0 +1,94 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+
+#include <cstring>
+
+#include "esepushreader.h"
+
+ESEPushReader::ESEPushReader ()
+: m_pushedOffset (0)
+, m_pushedEOS (false)
+{
+}
+
+void
+ESEPushReader::reset ()
+{
+  if (m_pushedOffset) {
+    ERR ("The start of the pushed stream has been released, continue from pos %" PRId64,
+      m_streamPosition);
+    return;
+  }
+  ESEReader::reset ();
+}
+
+bool
+ESEPushReader::seek (int64_t position)
+{
+  if (position < m_pushedOffset) {
+    ERR ("The pushed data at pos %" PRId64 " has been released", position);
+    return false;
+  }
+  return ESEReader::seek (position);
+}
+
+void
+ESEPushReader::push (const uint8_t *data, size_t size)
+{
+  if (m_pushedEOS) {
+    ERR ("Unable to push %zd bytes after the end of the stream", size);
+    return;
+  }
+  std::memcpy (m_pushed.prepare (size), data, size);
+  m_pushed.commit (size);
+  DBG ("Push %zd bytes, %" PRId64 " pushed", size, pushedSize ());
+}
+
+void
+ESEPushReader::pushEOS ()
+{
+  m_pushedEOS = true;
+}
+
+bool
+ESEPushReader::isEOS ()
+{
+  return m_pushedEOS && !m_bufferSize && m_streamPosition >= pushedSize ();
+}
+
+size_t
+ESEPushReader::readChunk (uint8_t *data, size_t size, int64_t pos)
+{
+  if (pos < m_pushedOffset) {
+    ERR ("The pushed data at pos %" PRId64 " has been released", pos);
+    return 0;
+  }
+  if (pos >= pushedSize ())
+    return 0;
+
+  size_t offset = static_cast<size_t> (pos - m_pushedOffset);
+  if (size > m_pushed.size () - offset)
+    size = m_pushed.size () - offset;
+  std::memcpy (data, m_pushed.data () + offset, size);
+  // Past the probing, the stream is only read forward.
+  if (pos + static_cast<int64_t> (size) > ESE_PUSH_REWIND_SIZE) {
+    m_pushed.consume (offset + size);
+    m_pushedOffset = pos + static_cast<int64_t> (size);
+  }
+  return size;
+}
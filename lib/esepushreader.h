@@ -0,0 +1,59 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include "esereader.h"
+
+#define ESE_PUSH_REWIND_SIZE (64 * 1024)
+// Minimum amount of pushed data to probe the stream format.
+#define ESE_PUSH_PROBE_SIZE 64
+
+/// @brief Reader of the data pushed by the application.
+/// The first ESE_PUSH_REWIND_SIZE bytes are kept so the stream can be probed
+/// from its start, the data is then released as soon as it has been read.
+/// A short read only means the end of the stream once pushEOS () is called.
+class ESEPushReader : public ESEReader {
+  public:
+  ESEPushReader ();
+  ~ESEPushReader () { }
+
+  virtual void reset ();
+  virtual bool prepare () { return true; }
+  virtual bool seek (int64_t position);
+
+  /// @brief Appends a copy of size bytes of data to the stream.
+  void push (const uint8_t *data, size_t size);
+  /// @brief Marks the end of the stream, no more data can be pushed.
+  void pushEOS ();
+  /// @brief Returns the number of bytes pushed since the start of the stream.
+  int64_t pushedSize () { return m_pushedOffset + static_cast<int64_t> (m_pushed.size ()); }
+  /// @brief Returns true while the stream can be read again from its start.
+  bool    canRewind () { return !m_pushedOffset; }
+
+  virtual size_t streamSize () { return 0; }
+  virtual bool   isEOS ();
+  virtual bool   isLive () { return !m_pushedEOS; }
+
+  protected:
+  virtual size_t readChunk (uint8_t *data, size_t size, int64_t pos);
+
+  private:
+  ESEReadBuffer m_pushed;
+  int64_t       m_pushedOffset;
+  bool          m_pushedEOS;
+};
@@ -0,0 +1,193 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <cstring>
+
+#include "esereadaheadreader.h"
+
+ESEReadAheadReader::ESEReadAheadReader (std::unique_ptr<ESEReader> source, size_t blocks)
+: m_source (std::move (source))
+, m_blocks (blocks ? blocks : 1)
+, m_running (false)
+{
+  reset ();
+}
+
+ESEReadAheadReader::~ESEReadAheadReader ()
+{
+  stop ();
+}
+
+void
+ESEReadAheadReader::reset ()
+{
+  stop ();
+  ESEReader::reset ();
+  m_source->reset ();
+  m_readIndex        = 0;
+  m_writeIndex       = 0;
+  m_filled           = 0;
+  m_blockOffset      = 0;
+  m_prefetchPosition = 0;
+  m_sourceEOS        = false;
+}
+
+bool
+ESEReadAheadReader::seek (int64_t position)
+{
+  // The blocks read ahead are dropped, the prefetch restarts from position.
+  stop ();
+  if (!m_source->seek (position) || !ESEReader::seek (position))
+    return false;
+  m_readIndex        = 0;
+  m_writeIndex       = 0;
+  m_filled           = 0;
+  m_blockOffset      = 0;
+  m_prefetchPosition = position;
+  m_sourceEOS        = false;
+  return true;
+}
+
+size_t
+ESEReadAheadReader::readAt (uint8_t *data, size_t size, int64_t pos)
+{
+  // The prefetch pauses while the source is read, it resumes with the next read.
+  stop ();
+  return m_source->readAt (data, size, pos);
+}
+
+bool
+ESEReadAheadReader::skip (size_t size)
+{
+  if (size <= m_buffer.size ())
+    return ESEReader::skip (size);
+  // The blocks read ahead are dropped instead of restarting the prefetch.
+  size -= m_buffer.size ();
+  m_buffer.clear ();
+  m_bufferSize     = 0;
+  size_t skip_size = readChunk (nullptr, size, m_streamPosition);
+  m_readSize += skip_size;
+  m_streamPosition += static_cast<int64_t> (skip_size);
+  return skip_size == size;
+}
+
+bool
+ESEReadAheadReader::prepare ()
+{
+  return m_source->prepare ();
+}
+
+bool
+ESEReadAheadReader::isEOS ()
+{
+  if (m_bufferSize)
+    return false;
+  return m_sourceEOS || (streamSize () && m_readSize == streamSize ());
+}
+
+void
+ESEReadAheadReader::start ()
+{
+  // The blocks filled before a pause are kept.
+  for (Block &block : m_blocks) {
+    if (!m_filled && block.capacity != bufferReadLength ()) {
+      block.data.reset (new uint8_t[bufferReadLength ()]);
+      block.capacity = bufferReadLength ();
+    }
+  }
+  m_running = true;
+  m_thread  = std::thread (&ESEReadAheadReader::run, this);
+  DBG ("Start a read-ahead of %zd blocks of %zd bytes", m_blocks.size (), bufferReadLength ());
+}
+
+void
+ESEReadAheadReader::stop ()
+{
+  if (!m_thread.joinable ())
+    return;
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_running = false;
+  }
+  m_cond.notify_all ();
+  m_thread.join ();
+}
+
+void
+ESEReadAheadReader::run ()
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+
+  while (m_running) {
+    if (m_filled == m_blocks.size ()) {
+      m_cond.wait (lock);
+      continue;
+    }
+    // The block at the write index is not visible to the reader until
+    // m_filled is incremented, so it can be filled without the lock.
+    Block  &block    = m_blocks[m_writeIndex];
+    int64_t position = m_prefetchPosition;
+    lock.unlock ();
+    size_t read_size = m_source->readChunk (block.data.get (), block.capacity, position);
+    lock.lock ();
+    block.size = read_size;
+    m_prefetchPosition += static_cast<int64_t> (read_size);
+    m_writeIndex = (m_writeIndex + 1) % m_blocks.size ();
+    m_filled++;
+    m_cond.notify_all ();
+    // An empty block marks the end of the stream.
+    if (!read_size)
+      break;
+  }
+}
+
+size_t
+ESEReadAheadReader::readChunk (uint8_t *data, size_t size, int64_t pos)
+{
+  size_t read_size = 0;
+
+  (void)pos;
+  if (m_sourceEOS)
+    return 0;
+  if (!m_thread.joinable ())
+    start ();
+
+  std::unique_lock<std::mutex> lock (m_mutex);
+  while (read_size < size) {
+    m_cond.wait (lock, [this] { return m_filled > 0; });
+    Block &block = m_blocks[m_readIndex];
+    if (!block.size) {
+      m_sourceEOS = true;
+      break;
+    }
+    size_t copy_size = block.size - m_blockOffset;
+    if (copy_size > size - read_size)
+      copy_size = size - read_size;
+    // The data is dropped without a destination.
+    if (data)
+      std::memcpy (data + read_size, block.data.get () + m_blockOffset, copy_size);
+    read_size += copy_size;
+    m_blockOffset += copy_size;
+    if (m_blockOffset == block.size) {
+      m_blockOffset = 0;
+      m_readIndex   = (m_readIndex + 1) % m_blocks.size ();
+      m_filled--;
+      m_cond.notify_all ();
+    }
+  }
+  return read_size;
+}
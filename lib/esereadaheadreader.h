@@ -0,0 +1,72 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "esereader.h"
+
+/// @brief Reader prefetching the chunks of another reader on a background thread.
+/// Up to blocks chunks of bufferReadLength () bytes are kept ready, so the
+/// stream parsing overlaps with the file reads or the application read callback.
+/// The source reader is only used from the background thread once started.
+class ESEReadAheadReader : public ESEReader {
+  public:
+  ESEReadAheadReader (std::unique_ptr<ESEReader> source, size_t blocks);
+  ~ESEReadAheadReader ();
+
+  virtual void reset ();
+  virtual bool prepare ();
+  virtual bool   seek (int64_t position);
+  virtual size_t readAt (uint8_t *data, size_t size, int64_t pos);
+  virtual bool   skip (size_t size);
+
+  virtual size_t streamSize () { return m_source->streamSize (); }
+  virtual bool   isEOS ();
+
+  protected:
+  virtual size_t readChunk (uint8_t *data, size_t size, int64_t pos);
+
+  private:
+  struct Block {
+    std::unique_ptr<uint8_t[]> data;
+    size_t                     capacity;
+    size_t                     size;
+  };
+
+  void start ();
+  void stop ();
+  void run ();
+
+  std::unique_ptr<ESEReader> m_source;
+  std::vector<Block>         m_blocks;
+  size_t                     m_readIndex;
+  size_t                     m_writeIndex;
+  size_t                     m_filled;
+  size_t                     m_blockOffset;
+  int64_t                    m_prefetchPosition;
+  bool                       m_running;
+  bool                       m_sourceEOS;
+  std::thread                m_thread;
+  std::mutex                 m_mutex;
+  std::condition_variable    m_cond;
+};
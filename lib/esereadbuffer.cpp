@@ -0,0 +1,85 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <cstring>
+
+#include "esereadbuffer.h"
+
+#define MINIMUM_READ_BUFFER_CAPACITY 4096
+
+ESEReadBuffer::ESEReadBuffer ()
+: m_data (nullptr)
+, m_capacity (0)
+, m_start (0)
+, m_end (0)
+{
+}
+
+ESEReadBuffer::~ESEReadBuffer ()
+{
+  delete[] m_data;
+}
+
+uint8_t *
+ESEReadBuffer::prepare (size_t size)
+{
+  size_t live = m_end - m_start;
+
+  if (m_capacity - m_end >= size)
+    return m_data + m_end;
+
+  if ((live + size) * 2 <= m_capacity) {
+    // Enough room once compacted: move the live bytes at the front.
+    std::memmove (m_data, m_data + m_start, live);
+  } else {
+    // Grow to twice the need, so the next compactions move less than half of
+    // the storage.
+    size_t capacity = (live + size) * 2;
+    if (capacity < MINIMUM_READ_BUFFER_CAPACITY)
+      capacity = MINIMUM_READ_BUFFER_CAPACITY;
+    uint8_t *data = new uint8_t[capacity];
+    if (live)
+      std::memcpy (data, m_data + m_start, live);
+    delete[] m_data;
+    m_data     = data;
+    m_capacity = capacity;
+  }
+  m_start = 0;
+  m_end   = live;
+  return m_data + m_end;
+}
+
+void
+ESEReadBuffer::commit (size_t size)
+{
+  m_end += size;
+}
+
+void
+ESEReadBuffer::consume (size_t size)
+{
+  m_start += size;
+  if (m_start >= m_end)
+    clear ();
+}
+
+void
+ESEReadBuffer::clear ()
+{
+  m_start = 0;
+  m_end   = 0;
+}
@@ -0,0 +1,55 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief Reusable byte buffer used by the readers.
+/// Bytes are appended at the end and consumed from the front. Consuming only
+/// moves a read offset, the storage is compacted lazily when the free space at
+/// the end is exhausted and grown geometrically, so both operations are
+/// amortized O(1). The storage is never zero-initialized.
+class ESEReadBuffer {
+  public:
+  ESEReadBuffer ();
+  ~ESEReadBuffer ();
+
+  const uint8_t *data () const { return m_data + m_start; }
+  size_t         size () const { return m_end - m_start; }
+  size_t         capacity () const { return m_capacity; }
+
+  /// @brief Returns room for size bytes at the end of the buffer.
+  /// The content is undefined until commit is called.
+  uint8_t *prepare (size_t size);
+  /// @brief Validates size bytes written after the last prepare.
+  void commit (size_t size);
+  /// @brief Drops size bytes from the front of the buffer.
+  void consume (size_t size);
+  /// @brief Empties the buffer and keeps the storage for reuse.
+  void clear ();
+
+  private:
+  ESEReadBuffer (const ESEReadBuffer &);
+  ESEReadBuffer &operator= (const ESEReadBuffer &);
+
+  uint8_t *m_data;
+  size_t   m_capacity;
+  size_t   m_start;
+  size_t   m_end;
+};
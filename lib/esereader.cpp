@@ -35,5 +35,70 @@ ESEReader::reset ()
   m_streamPosition   = 0;
   m_bufferSize       = 0;
   m_readSize         = 0;
-  m_buffer           = ESEBuffer ();
+  m_buffer.clear ();
+}
+
+bool
+ESEReader::seek (int64_t position)
+{
+  if (position < 0 || (streamSize () && static_cast<size_t> (position) > streamSize ()))
+    return false;
+  m_streamPosition = position;
+  m_bufferSize     = 0;
+  m_readSize       = static_cast<size_t> (position);
+  m_buffer.clear ();
+  DBG ("Seek to pos %" PRId64, position);
+  return true;
+}
+
+bool
+ESEReader::skip (size_t size)
+{
+  if (size <= m_buffer.size ()) {
+    m_buffer.consume (size);
+    m_bufferSize = m_buffer.size ();
+    return true;
+  }
+  return seek (position () + static_cast<int64_t> (size));
+}
+
+size_t
+ESEReader::readBuffer (size_t size)
+{
+  size_t read_size;
+
+  // Read straight to the end of the buffer, no intermediate copy.
+  read_size = readChunk (m_buffer.prepare (size), size, m_streamPosition);
+  m_buffer.commit (read_size);
+  m_readSize += read_size;
+  m_streamPosition += static_cast<int64_t> (read_size);
+  m_bufferSize = m_buffer.size ();
+  DBG ("Append %zd to a buffer of new size %zd read %zd", size, m_buffer.size (), read_size);
+  return read_size;
+}
+
+ESEBuffer
+ESEReader::getBuffer (size_t size)
+{
+  ESEBuffer buffer;
+  appendBuffer (buffer, size);
+  return buffer;
+}
+
+size_t
+ESEReader::appendBuffer (ESEBuffer &buffer, size_t size)
+{
+  size_t real_size = size;
+
+  while (m_buffer.size () < size) {
+    if (readBuffer (bufferReadLength ()) < bufferReadLength ())
+      break;
+  }
+  if (m_buffer.size () < size)
+    real_size = m_buffer.size ();
+
+  buffer.insert (buffer.end (), m_buffer.data (), m_buffer.data () + real_size);
+  m_buffer.consume (real_size);
+  m_bufferSize = m_buffer.size ();
+  return real_size;
 }
@@ -17,7 +17,10 @@
 
 #pragma once
 
+#include <memory>
+
 #include "eselogger.h"
+#include "esereadbuffer.h"
 #include "eseutils.h"
 #include "esextractor.h"
 
@@ -30,21 +33,54 @@ class ESEReader {
   /// @brief Reset the reader
   virtual void reset ();
 
-  virtual bool      prepare ()              = 0;
-  virtual ESEBuffer getBuffer (size_t size) = 0;
+  virtual bool prepare () = 0;
+  /// @brief Moves the reader to position, dropping the data read ahead.
+  /// @return false if the stream can not be read from position.
+  virtual bool seek (int64_t position);
+  /// @brief Reads up to size bytes located at pos to data, without moving the reader.
+  /// @return the number of bytes read, less than size at the end of the stream.
+  virtual size_t readAt (uint8_t *data, size_t size, int64_t pos) { return readChunk (data, size, pos); }
+  /// @brief Moves the reader size bytes forward, without reading them when
+  /// they are not read ahead yet.
+  /// @return false if the stream can not be read from the new position.
+  virtual bool skip (size_t size);
+  /// @brief Returns the next size bytes of the stream, or less at the end of the stream.
+  ESEBuffer getBuffer (size_t size);
+  /// @brief Appends the next size bytes of the stream to buffer, or less at
+  /// the end of the stream. The buffer storage is reused.
+  /// @return the number of bytes appended.
+  virtual size_t appendBuffer (ESEBuffer &buffer, size_t size);
 
   size_t         readSize () { return m_readSize; }
   virtual size_t streamSize () = 0;
-  int32_t        streamPosition () { return m_streamPosition; }
+  int64_t        streamPosition () { return m_streamPosition; }
+  /// @brief Returns the position of the next byte appended to a buffer,
+  /// before the data read ahead.
+  int64_t        position () { return m_streamPosition - static_cast<int64_t> (m_bufferSize); }
   size_t         bufferReadLength () { return m_bufferReadLength; }
   void           setBufferReadLength (size_t bufferReadLength) { m_bufferReadLength = bufferReadLength; }
 
   virtual bool isEOS () = 0;
+  /// @brief Returns true while data can still be appended to the stream, a
+  /// short read then means that the data is not available yet.
+  virtual bool isLive () { return false; }
+  /// @brief Returns the whole stream, streamSize () bytes, when it is held in
+  /// memory or null otherwise. The memory is valid while a reference is held,
+  /// even after the reader is destroyed.
+  virtual std::shared_ptr<const uint8_t> mapping () { return nullptr; }
 
   protected:
-  int32_t   m_streamPosition;
-  size_t    m_bufferSize;
-  size_t    m_readSize;
-  size_t    m_bufferReadLength;
-  ESEBuffer m_buffer;
+  friend class ESEReadAheadReader;
+
+  /// @brief Reads up to size bytes located at pos in the stream to data.
+  /// @return the number of bytes read, less than size at the end of the stream.
+  virtual size_t readChunk (uint8_t *data, size_t size, int64_t pos) = 0;
+  /// @brief Appends the next chunk of the stream to the buffer.
+  size_t readBuffer (size_t size);
+
+  int64_t       m_streamPosition;
+  size_t        m_bufferSize;
+  size_t        m_readSize;
+  size_t        m_bufferReadLength;
+  ESEReadBuffer m_buffer;
 };
@@ -0,0 +1,246 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+
+#include <cstring>
+
+#include "esescan.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#  define ESE_SCAN_X86 1
+#  include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#  define ESE_SCAN_NEON 1
+#  include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+#  include <intrin.h>
+#  define ESE_TARGET_AVX2
+#else
+#  define ESE_TARGET_AVX2 __attribute__ ((target ("avx2")))
+#endif
+
+static inline unsigned
+ese_ctz64 (uint64_t value)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64 (&index, value);
+  return static_cast<unsigned> (index);
+#else
+  return static_cast<unsigned> (__builtin_ctzll (value));
+#endif
+}
+
+static size_t
+ese_scan_scalar (const uint8_t *data, size_t size)
+{
+  for (size_t i = 0; i + 2 < size; i++) {
+    if (data[i] == 0x00 && data[i + 1] == 0x00 && data[i + 2] == 0x01)
+      return i;
+  }
+  return size;
+}
+
+/// @brief Looks for the 0x01 bytes with memchr and checks the two bytes before.
+static size_t
+ese_scan_memchr (const uint8_t *data, size_t size)
+{
+  size_t i = 2;
+
+  while (i < size) {
+    const void *found = std::memchr (data + i, 0x01, size - i);
+    if (!found)
+      break;
+    i = static_cast<size_t> (static_cast<const uint8_t *> (found) - data);
+    if (data[i - 1] == 0x00 && data[i - 2] == 0x00)
+      return i - 2;
+    i++;
+  }
+  return size;
+}
+
+#define ESE_SWAR_LOWS 0x7f7f7f7f7f7f7f7fULL
+
+/// @brief Flags the zero bytes of 8-byte words and skips the words without
+/// two adjacent zero bytes, which can not hold the start of a start code.
+/// The words overlap by a byte to catch the pairs across two words.
+static size_t
+ese_scan_swar (const uint8_t *data, size_t size)
+{
+  size_t i = 0;
+
+  while (i + 10 <= size) {
+    uint64_t word;
+    std::memcpy (&word, data + i, sizeof (word));
+    uint64_t zeros = ~(((word & ESE_SWAR_LOWS) + ESE_SWAR_LOWS) | word | ESE_SWAR_LOWS);
+    if (zeros & (zeros << 8)) {
+      for (size_t j = i; j < i + 7; j++) {
+        if (data[j] == 0x00 && data[j + 1] == 0x00 && data[j + 2] == 0x01)
+          return j;
+      }
+    }
+    i += 7;
+  }
+  return i + ese_scan_scalar (data + i, size - i);
+}
+
+#ifdef ESE_SCAN_X86
+// The three bytes of each candidate position are compared with unaligned
+// loads at offsets 0, 1 and 2, one bit per position in the resulting mask.
+static size_t
+ese_scan_sse2 (const uint8_t *data, size_t size)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i one  = _mm_set1_epi8 (1);
+  size_t        i    = 0;
+
+  for (; i + 18 <= size; i += 16) {
+    __m128i  b0   = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (data + i));
+    __m128i  b1   = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (data + i + 1));
+    __m128i  b2   = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (data + i + 2));
+    __m128i  m    = _mm_and_si128 (_mm_and_si128 (_mm_cmpeq_epi8 (b0, zero), _mm_cmpeq_epi8 (b1, zero)),
+          _mm_cmpeq_epi8 (b2, one));
+    unsigned mask = static_cast<unsigned> (_mm_movemask_epi8 (m));
+    if (mask)
+      return i + ese_ctz64 (mask);
+  }
+  return i + ese_scan_scalar (data + i, size - i);
+}
+
+ESE_TARGET_AVX2 static size_t
+ese_scan_avx2 (const uint8_t *data, size_t size)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i one  = _mm256_set1_epi8 (1);
+  size_t        i    = 0;
+
+  for (; i + 34 <= size; i += 32) {
+    __m256i  b0   = _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (data + i));
+    __m256i  b1   = _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (data + i + 1));
+    __m256i  b2   = _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (data + i + 2));
+    __m256i  m    = _mm256_and_si256 (_mm256_and_si256 (_mm256_cmpeq_epi8 (b0, zero), _mm256_cmpeq_epi8 (b1, zero)),
+          _mm256_cmpeq_epi8 (b2, one));
+    uint32_t mask = static_cast<uint32_t> (_mm256_movemask_epi8 (m));
+    if (mask)
+      return i + ese_ctz64 (mask);
+  }
+  return i + ese_scan_scalar (data + i, size - i);
+}
+
+static bool
+ese_cpu_has_avx2 ()
+{
+#  ifdef _MSC_VER
+  int info[4];
+  __cpuid (info, 0);
+  if (info[0] < 7)
+    return false;
+  // AVX2 needs the OS to save the YMM registers.
+  __cpuid (info, 1);
+  if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) || (_xgetbv (0) & 6) != 6)
+    return false;
+  __cpuidex (info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#  else
+  __builtin_cpu_init ();
+  return __builtin_cpu_supports ("avx2");
+#  endif
+}
+#endif
+
+#ifdef ESE_SCAN_NEON
+static size_t
+ese_scan_neon (const uint8_t *data, size_t size)
+{
+  const uint8x16_t zero = vdupq_n_u8 (0);
+  const uint8x16_t one  = vdupq_n_u8 (1);
+  size_t           i    = 0;
+
+  for (; i + 18 <= size; i += 16) {
+    uint8x16_t b0 = vld1q_u8 (data + i);
+    uint8x16_t b1 = vld1q_u8 (data + i + 1);
+    uint8x16_t b2 = vld1q_u8 (data + i + 2);
+    uint8x16_t m  = vandq_u8 (vandq_u8 (vceqq_u8 (b0, zero), vceqq_u8 (b1, zero)), vceqq_u8 (b2, one));
+    // Narrow each byte of the mask to a nibble of a 64-bit word.
+    uint64_t mask = vget_lane_u64 (vreinterpret_u64_u8 (vshrn_n_u16 (vreinterpretq_u16_u8 (m), 4)), 0);
+    if (mask)
+      return i + (ese_ctz64 (mask) >> 2);
+  }
+  return i + ese_scan_scalar (data + i, size - i);
+}
+#endif
+
+static std::vector<ESEScanKernel>
+ese_scan_supported_kernels ()
+{
+  std::vector<ESEScanKernel> kernels;
+
+#ifdef ESE_SCAN_X86
+  if (ese_cpu_has_avx2 ())
+    kernels.push_back ({ "avx2", ese_scan_avx2 });
+  kernels.push_back ({ "sse2", ese_scan_sse2 });
+#endif
+#ifdef ESE_SCAN_NEON
+  kernels.push_back ({ "neon", ese_scan_neon });
+#endif
+  kernels.push_back ({ "swar", ese_scan_swar });
+  kernels.push_back ({ "memchr", ese_scan_memchr });
+  kernels.push_back ({ "scalar", ese_scan_scalar });
+  return kernels;
+}
+
+const std::vector<ESEScanKernel> &
+ese_scan_kernels ()
+{
+  static const std::vector<ESEScanKernel> kernels = ese_scan_supported_kernels ();
+  return kernels;
+}
+
+size_t
+ese_scan_start_code (const uint8_t *data, size_t size)
+{
+  static const ESEScanFunc scan = ese_scan_kernels ().front ().scan;
+  return scan (data, size);
+}
+
+size_t
+ESEStartCodeScanner::scan (const uint8_t *data, size_t pos, size_t size)
+{
+  // Complete a start code begun by the zeros ending the previous range.
+  for (; pos < size && m_zeros; pos++) {
+    if (data[pos] == 0x01 && m_zeros >= 2) {
+      m_zeros = 0;
+      return pos - 2;
+    }
+    m_zeros = data[pos] ? 0 : m_zeros + 1;
+  }
+  if (pos == size)
+    return size;
+
+  size_t offset = ese_scan_start_code (data + pos, size - pos);
+  if (offset < size - pos) {
+    m_zeros = 0;
+    return pos + offset;
+  }
+
+  // Keep the trailing zeros for the next range.
+  while (m_zeros < 2 && size - m_zeros > pos && !data[size - m_zeros - 1])
+    m_zeros++;
+  return size;
+}
@@ -0,0 +1,63 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief Start code scanning kernel.
+/// @return the offset of the first 00 00 01 sequence fully contained in the
+/// size bytes of data, or size if there is none.
+typedef size_t (*ESEScanFunc) (const uint8_t *data, size_t size);
+
+typedef struct ESEScanKernel {
+  const char *name;
+  ESEScanFunc scan;
+} ESEScanKernel;
+
+/// @brief Returns the kernels supported by the CPU, the fastest first.
+const std::vector<ESEScanKernel> &
+ese_scan_kernels ();
+
+/// @brief Scans data for a start code with the fastest kernel.
+size_t
+ese_scan_start_code (const uint8_t *data, size_t size);
+
+/// @brief Resumable start code scanner.
+/// Each byte is scanned once: the zero bytes ending a scanned range are
+/// remembered to find the start codes split across two ranges.
+class ESEStartCodeScanner {
+  public:
+  ESEStartCodeScanner ()
+  : m_zeros (0)
+  {
+  }
+
+  void reset () { m_zeros = 0; }
+
+  /// @brief Scans data from pos to size, the bytes before pos having been
+  /// scanned by the previous calls.
+  /// @return the offset of the next 00 00 01 sequence in data, which can
+  /// start before pos, or size if there is none yet. The scan then resumes
+  /// after the returned sequence.
+  size_t scan (const uint8_t *data, size_t pos, size_t size);
+
+  private:
+  size_t m_zeros;
+};
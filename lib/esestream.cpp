@@ -16,12 +16,18 @@
  */
 #define _CRT_SECURE_NO_WARNINGS 1
 
+#include <cstdlib>
+
 #include "eseannexbstream.h"
 #include "esedatareader.h"
 #include "esefilereader.h"
 #include "eseivfstream.h"
 #include "eselogger.h"
+#include "esemmapreader.h"
 #include "esenalstream.h"
+#include "esereadaheadreader.h"
+#include "esescan.h"
+#include "eseuringreader.h"
 #include "eseutils.h"
 
 ESEVideoFormat
@@ -42,16 +48,17 @@ ese_stream_probe_video_format (ESEStream *stream)
 
 ESEStream::ESEStream (ESEVideoFormat format)
 : m_format (format)
-, m_currentPacket (nullptr)
-, m_nextPacket (nullptr)
+, m_descriptorOnly (false)
+, m_keyframesOnly (false)
 {
   reset ();
 }
 
 ESEStream::~ESEStream ()
 {
-  DBG ("Found %u frame and read %d of %d", m_frameCount, m_reader->readSize (),
-    m_reader->streamSize ());
+  if (m_reader)
+    DBG ("Found %" PRIu64 " frame and read %zd of %zd", m_frameCount, m_reader->readSize (),
+      m_reader->streamSize ());
 }
 
 void
@@ -60,10 +67,9 @@ ESEStream::reset ()
   m_eos            = false;
   m_bufferPosition = 0;
   m_frameCount     = 0;
-  m_currentPacket  = nullptr;
-  if (m_nextPacket)
-    delete m_nextPacket;
-  m_nextPacket   = nullptr;
+  m_packetReady    = false;
+  m_packetStorage  = nullptr;
+  m_packetSlices.clear ();
   m_codec        = ESE_VIDEO_CODEC_UNKNOWN;
   m_buffer       = ESEBuffer ();
   m_currentFrame = ESEBuffer ();
@@ -75,10 +81,22 @@ bool
 ESEStream::prepare (const char *uri, const char *options)
 {
   parseOptions (options);
-  m_reader = make_unique<ESEFileReader> (uri);
+  const std::string &reader = m_options["reader"];
+  // Map regular files in memory and keep the stream reader for the others.
+  // A mapping would fault synchronously, so use the stream reader for read-ahead.
+  if ((reader.empty () || reader == "mmap") && !readAheadBlocks ()) {
+    m_reader = make_unique<ESEMmapReader> (uri);
+    if (m_reader->prepare ())
+      return prepareReader ();
+    DBG ("Unable to map %s, use the file reader", uri);
+  }
+  if (reader == "uring")
+    m_reader = make_unique<ESEUringReader> (uri);
+  else
+    m_reader = make_unique<ESEFileReader> (uri);
   if (!m_reader->prepare ())
     return false;
-  return (processToNextFrame () <= ESE_RESULT_ERROR);
+  return prepareReader ();
 }
 
 bool
@@ -88,9 +106,47 @@ ESEStream::prepare (ese_read_buffer_func read_func, void *pointer, const char *o
   m_reader = make_unique<ESEDataReader> (read_func, pointer);
   if (!m_reader->prepare ())
     return false;
+  return prepareReader ();
+}
+
+bool
+ESEStream::prepare (ese_read_buffer_func64 read_func, void *pointer, const char *options)
+{
+  parseOptions (options);
+  m_reader = make_unique<ESEDataReader> (read_func, pointer);
+  if (!m_reader->prepare ())
+    return false;
+  return prepareReader ();
+}
+
+bool
+ESEStream::prepare (std::unique_ptr<ESEReader> reader, const char *options)
+{
+  parseOptions (options);
+  m_reader = std::move (reader);
+  m_reader->reset ();
+  return (processToNextFrame () <= ESE_RESULT_ERROR);
+}
+
+bool
+ESEStream::prepareReader ()
+{
+  size_t blocks = readAheadBlocks ();
+  if (blocks) {
+    INFO ("Read ahead %zd blocks", blocks);
+    m_reader = make_unique<ESEReadAheadReader> (std::move (m_reader), blocks);
+  }
   return (processToNextFrame () <= ESE_RESULT_ERROR);
 }
 
+size_t
+ESEStream::readAheadBlocks ()
+{
+  if (m_options.count ("readahead") == 0)
+    return 0;
+  return static_cast<size_t> (strtoul (m_options["readahead"].c_str (), nullptr, 10));
+}
+
 void
 ESEStream::setBufferReadLength (size_t len)
 {
@@ -104,9 +160,16 @@ ESEStream::setOptions (const char *options)
   parseOptions (options);
 }
 
-ESEBuffer
-ESEStream::prepareFrame (ESEBuffer buffer, size_t start,
-  size_t end)
+std::string
+ESEStream::option (const std::string &name)
+{
+  std::map<std::string, std::string>::const_iterator it = m_options.find (name);
+  return it != m_options.end () ? it->second : std::string ();
+}
+
+void
+ESEStream::prepareFrame (ESEBufferView buffer, size_t start,
+  size_t end, ESEBuffer &frame)
 {
   size_t frame_start = start;
   if (start > buffer.size () || end > buffer.size ()) {
@@ -115,52 +178,205 @@ ESEStream::prepareFrame (ESEBuffer buffer, size_t start,
   if (start > end) {
     throw std::invalid_argument ("start position must be less than end position");
   }
-  ESEBuffer frame = ESEBuffer (buffer.begin () + frame_start,
+  // Write the start code first to copy the frame data only once.
+  ESEBufferView start_code = getStartCode ();
+  frame.assign (start_code.begin (), start_code.end ());
+  frame.insert (frame.end (), buffer.begin () + frame_start,
     buffer.begin () + end);
+}
 
-  ESEBuffer start_code = getStartCode ();
-  frame.insert (frame.begin (), start_code.begin (), start_code.end ());
+void
+ESEStream::prepareNextPacket (ESEBuffer &frame, uint64_t pts, uint64_t dts, uint64_t duration)
+{
+  ESESlice slice;
+
+  m_packetFrame.swap (frame);
+  slice.data = m_packetFrame.data ();
+  slice.size = m_packetFrame.size ();
+  m_packetSlices.clear ();
+  m_packetSlices.push_back (slice);
+  m_packetStorage        = nullptr;
+  m_packetInfo.data_size = slice.size;
+  m_packetInfo.pts       = pts;
+  m_packetInfo.dts       = dts;
+  m_packetInfo.duration  = duration;
+  m_packetReady          = true;
+  m_frameCount++;
+}
 
-  return frame;
+void
+ESEStream::prepareBorrowedPacket (ESEBufferView data, const std::shared_ptr<const uint8_t> &storage)
+{
+  ESESlice slice;
+
+  slice.data = data.data ();
+  slice.size = data.size ();
+  m_packetSlices.clear ();
+  m_packetSlices.push_back (slice);
+  m_packetStorage        = storage;
+  m_packetInfo.data_size = slice.size;
+  m_packetInfo.pts       = 0;
+  m_packetInfo.dts       = 0;
+  m_packetInfo.duration  = 0;
+  m_packetReady          = true;
+  m_frameCount++;
 }
 
-ESEPacket *
-ESEStream::prepareNextPacket (uint64_t pts, uint64_t dts, uint64_t duration)
-{
-  m_nextPacket       = new ESEPacket ();
-  m_nextPacket->data = static_cast<std::uint8_t *> (std::malloc (m_currentFrame.size ()));
-  std::memcpy (m_nextPacket->data, m_currentFrame.data (), m_currentFrame.size ());
-  m_nextPacket->data_size = m_currentFrame.size ();
-  m_nextPacket->pts       = pts;
-  m_nextPacket->dts       = dts;
-  m_nextPacket->duration  = duration;
+void
+ESEStream::prepareGatheredPacket (ESEBuffer &frame, const std::vector<ESESlice> &slices, const std::shared_ptr<const uint8_t> &storage)
+{
+  // Swapping keeps the frame storage, so the slices remain valid.
+  m_packetFrame.swap (frame);
+  m_packetSlices.assign (slices.begin (), slices.end ());
+  m_packetStorage        = storage;
+  m_packetInfo.data_size = 0;
+  for (const ESESlice &slice : m_packetSlices)
+    m_packetInfo.data_size += slice.size;
+  m_packetInfo.pts      = 0;
+  m_packetInfo.dts      = 0;
+  m_packetInfo.duration = 0;
+  m_packetReady         = true;
+  m_frameCount++;
+}
+
+void
+ESEStream::prepareEmptyPacket (uint64_t pts, uint64_t dts, uint64_t duration)
+{
+  m_packetSlices.clear ();
+  m_packetStorage        = nullptr;
+  m_packetInfo.data_size = 0;
+  m_packetInfo.pts       = pts;
+  m_packetInfo.dts       = dts;
+  m_packetInfo.duration  = duration;
+  m_packetReady          = true;
   m_frameCount++;
-  return m_nextPacket;
+}
+
+void
+ESEStream::indexPacket (uint64_t offset, uint64_t size, uint32_t type, bool keyframe)
+{
+  m_packetDescriptor.offset = offset;
+  m_packetDescriptor.size   = size;
+  m_packetDescriptor.pts    = m_packetInfo.pts;
+  m_packetDescriptor.type   = type;
+  m_packetDescriptor.flags  = keyframe ? ESE_PACKET_FLAG_KEYFRAME : 0;
+  if (m_index)
+    m_index->record (m_frameCount - 1, m_packetDescriptor);
+}
+
+bool
+ESEStream::seek (uint64_t number)
+{
+  (void)number;
+  ERR ("Unable to seek in a stream of format %d", m_format);
+  return false;
+}
+
+void
+ESEStream::prepareSeek (uint64_t number)
+{
+  m_eos            = false;
+  m_bufferPosition = 0;
+  m_frameCount     = number;
+  m_packetReady    = false;
+  m_packetStorage  = nullptr;
+  m_packetSlices.clear ();
+  m_buffer.clear ();
+  m_currentFrame.clear ();
 }
 
 ESEPacket *
 ESEStream::currentPacket ()
 {
-  m_currentPacket = m_nextPacket;
-  m_nextPacket    = nullptr;
-  return m_currentPacket;
+  ESEPacket *packet;
+  uint8_t   *data;
+
+  if (!m_packetReady)
+    return nullptr;
+  if (!m_packetPool)
+    m_packetPool = std::make_shared<ESEPacketPool> ();
+  if (m_packetStorage && m_packetSlices.size () == 1) {
+    packet = m_packetPool->acquire (m_packetSlices[0].data, m_packetSlices[0].size, m_packetStorage);
+    if (!packet)
+      return nullptr;
+  } else {
+    packet = m_packetPool->acquire (m_packetInfo.data_size);
+    if (!packet)
+      return nullptr;
+    data = packet->data;
+    for (const ESESlice &slice : m_packetSlices) {
+      std::memcpy (data, slice.data, slice.size);
+      data += slice.size;
+    }
+  }
+  packet->packet_number = static_cast<int32_t> (m_frameCount - 1);
+  packet->pts           = m_packetInfo.pts;
+  packet->dts           = m_packetInfo.dts;
+  packet->duration      = m_packetInfo.duration;
+  m_packetStorage       = nullptr;
+  m_packetReady         = false;
+  return packet;
 }
 
-int32_t
-ESEStream::scanMPEGHeader (ESEBuffer buffer, int32_t pos)
+bool
+ESEStream::readPacketInto (uint8_t *data, size_t capacity, ESEPacketInfo *info)
 {
-  DBG ("Scan MPEG HEADER pos %d buffer.size () %d", pos, buffer.size ());
-  for (uint32_t i = pos; i < buffer.size () - 3; i++) {
-    bool found = (buffer[i] == 0x00 && buffer[i + 1] == 0x00
-      && buffer[i + 2] == 0x01);
-    if (found)
-      return i;
+  *info               = m_packetInfo;
+  info->packet_number = m_frameCount - 1;
+  if (m_packetInfo.data_size > capacity)
+    return false;
+  for (const ESESlice &slice : m_packetSlices) {
+    std::memcpy (data, slice.data, slice.size);
+    data += slice.size;
   }
-  return -1;
+  m_packetStorage = nullptr;
+  m_packetReady   = false;
+  return true;
+}
+
+const std::vector<ESESlice> &
+ESEStream::readPacketSlices (ESEPacketInfo *info)
+{
+  *info               = m_packetInfo;
+  info->packet_number = m_frameCount - 1;
+  m_packetStorage     = nullptr;
+  m_packetReady       = false;
+  return m_packetSlices;
+}
+
+void
+ESEStream::skipPacket ()
+{
+  m_packetStorage = nullptr;
+  m_packetReady   = false;
 }
 
 bool
-ESEStream::isH265 (ESEBuffer buffer)
+ESEStream::readPayload (const ESEPacketDescriptor &descriptor, uint8_t *data)
+{
+  size_t size = static_cast<size_t> (descriptor.size);
+
+  if (!m_reader)
+    return false;
+  return m_reader->readAt (data, size, static_cast<int64_t> (descriptor.offset)) == size;
+}
+
+int64_t
+ESEStream::scanMPEGHeader (ESEBufferView buffer, int64_t pos)
+{
+  DBG ("Scan MPEG HEADER pos %" PRId64 " buffer.size () %zd", pos, buffer.size ());
+  // The start code must be followed by at least one byte.
+  if (buffer.size () < 4 || static_cast<size_t> (pos) > buffer.size () - 4)
+    return -1;
+  size_t size   = buffer.size () - 1 - static_cast<size_t> (pos);
+  size_t offset = ese_scan_start_code (buffer.data () + pos, size);
+  if (offset == size)
+    return -1;
+  return pos + static_cast<int64_t> (offset);
+}
+
+bool
+ESEStream::isH265 (ESEBufferView buffer)
 {
   int  nut;
   bool found = false;
@@ -194,7 +410,7 @@ ESEStream::isH265 (ESEBuffer buffer)
 }
 
 bool
-ESEStream::isH264 (ESEBuffer buffer)
+ESEStream::isH264 (ESEBufferView buffer)
 {
   int  nut, ref;
   bool found = false;
@@ -230,10 +446,10 @@ ESEStream::isH264 (ESEBuffer buffer)
   return found;
 }
 
-int32_t
+int64_t
 ESEStream::probeH26x ()
 {
-  int32_t offset;
+  int64_t offset;
   m_reader->reset ();
   m_buffer = m_reader->getBuffer (MPEG_HEADER_SIZE * MAX_SEARCH_SIZE);
 
@@ -241,26 +457,28 @@ ESEStream::probeH26x ()
   if (offset > 0) {
     /* start code might have 2 or 3 0-bytes */
     offset += 3;
-    ESEBuffer buffer = subVector (m_buffer, offset, MAX_SEARCH_SIZE);
+    ESEBufferView buffer = ESEBufferView (m_buffer).subView (static_cast<size_t> (offset), MAX_SEARCH_SIZE);
     if (isH264 (buffer) || isH265 (buffer))
       return offset;
   }
   return -1;
 }
 
-int32_t
+int64_t
 ESEStream::probeIVF ()
 {
   IVFHeader ivf_header;
   m_reader->reset ();
   m_buffer = m_reader->getBuffer (sizeof (IVFHeader));
+  if (m_buffer.size () < sizeof (IVFHeader))
+    return -1;
   std::memcpy (&ivf_header, m_buffer.data (), sizeof (IVFHeader));
   if (ivf_header.signature == ESE_MAKE_FOURCC ('D', 'K', 'I', 'F'))
     return 0;
   return -1;
 }
 
-int32_t
+int64_t
 ESEStream::probeAnnexB ()
 {
   if (m_options.count ("format") == 1 && m_options["format"] == "annex-b")
@@ -274,11 +492,20 @@ ESEStream::parseOptions (const char *options)
   char *token;
   if (options == nullptr)
     return;
-  token = strtok (const_cast<char *> (options), "\n");
+  // Tokenize a copy, the options of the application may be read-only.
+  std::string copy (options);
+  token = strtok (&copy[0], "\n");
   while (token != NULL) {
     std::string s (token);
     size_t      pos              = s.find (":");
     m_options[s.substr (0, pos)] = s.substr (pos + 1, std::string::npos);
     token                        = strtok (NULL, "\n");
   }
+  if (m_options.count ("packet-pool-size")) {
+    if (!m_packetPool)
+      m_packetPool = std::make_shared<ESEPacketPool> ();
+    m_packetPool->setMaxSize (static_cast<size_t> (strtoull (m_options["packet-pool-size"].c_str (), nullptr, 10)));
+  }
+  m_descriptorOnly = option ("packet-data") == "none";
+  m_keyframesOnly  = option ("filter") == "keyframes";
 }
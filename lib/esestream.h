@@ -18,12 +18,15 @@
 #pragma once
 
 #include <cstring>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "esedatareader.h"
+#include "eseindex.h"
+#include "esepacketpool.h"
 #include "esextractor.h"
 
 #define MAX_SEARCH_SIZE 5
@@ -40,49 +43,131 @@ class ESEStream {
 
   bool         prepare (const char *uri, const char *options = nullptr);
   bool         prepare (ese_read_buffer_func func, void *pointer, const char *options);
+  bool         prepare (ese_read_buffer_func64 func, void *pointer, const char *options);
+  bool         prepare (std::unique_ptr<ESEReader> reader, const char *options);
+  /// @brief Gives the reader back, to prepare another stream with it.
+  std::unique_ptr<ESEReader> releaseReader () { return std::move (m_reader); }
   void         setBufferReadLength (size_t len);
+  /// @brief Sets the pool providing the packets, shared by the streams of an extractor.
+  void         setPacketPool (std::shared_ptr<ESEPacketPool> pool) { m_packetPool = pool; }
+  /// @brief Sets the index recording the descriptors of the packets.
+  void         setIndex (std::shared_ptr<ESEIndex> index) { m_index = index; }
   void         setOptions (const char *options);
+  /// @brief Returns the value of an option, or an empty string if not set.
+  std::string  option (const std::string &name);
   virtual void parseOptions (const char *options);
   /// @brief This method will build the next frame (NAL or AU) available.
   /// @return
   virtual ESEResult processToNextFrame () { return ESE_RESULT_NO_PACKET; };
 
-  int32_t scanMPEGHeader (ESEBuffer buffer, int32_t pos = 0);
-  int32_t probeH26x ();
-  int32_t probeIVF ();
-  int32_t probeAnnexB ();
-  bool    isH264 (ESEBuffer buffer);
-  bool    isH265 (ESEBuffer buffer);
+  int64_t scanMPEGHeader (ESEBufferView buffer, int64_t pos = 0);
+  int64_t probeH26x ();
+  int64_t probeIVF ();
+  int64_t probeAnnexB ();
+  bool    isH264 (ESEBufferView buffer);
+  bool    isH265 (ESEBufferView buffer);
   bool    isAnnexB ();
 
   ESEVideoCodec  codec () { return m_codec; }
   ESEVideoFormat format () { return m_format; }
   ESEBuffer     *currentFrame () { return &m_currentFrame; }
+  /// @brief Returns true while the packet of the last frame has not been read.
+  bool           hasPacket () { return m_packetReady; }
+  /// @brief Returns the packet of the last frame, to release with ESEPacketPool::release.
   ESEPacket     *currentPacket ();
+  /// @brief Writes the payload of the packet of the last frame to data.
+  /// @return false, keeping the packet, if its size exceeds capacity.
+  bool           readPacketInto (uint8_t *data, size_t capacity, ESEPacketInfo *info);
+  /// @brief Returns the slices of the packet of the last frame, valid until the next frame.
+  const std::vector<ESESlice> &readPacketSlices (ESEPacketInfo *info);
+  /// @brief Drops the packet of the last frame.
+  void                         skipPacket ();
+  /// @brief Reads the bytes of the stream located by descriptor to data,
+  /// without moving the stream.
+  /// @return false if they can not be read again.
+  bool                         readPayload (const ESEPacketDescriptor &descriptor, uint8_t *data);
+  /// @brief Returns the location of the packet of the last frame in the stream.
+  const ESEPacketDescriptor   &packetDescriptor () { return m_packetDescriptor; }
+  /// @brief Returns how the packets are aligned and filtered, which an index depends on.
+  virtual uint32_t             packetAlignment () { return 0; }
+  /// @brief Returns true if only the key frames are returned, with filter:keyframes.
+  bool                         keyframesOnly () { return m_keyframesOnly; }
+  /// @brief Returns true if the packet described is returned with filter:keyframes.
+  virtual bool                 isKeyframePacket (const ESEPacketDescriptor &descriptor)
+  {
+    return descriptor.flags & ESE_PACKET_FLAG_KEYFRAME;
+  }
+  /// @brief Moves the stream to the packet number of the index, which the
+  /// next frame processed prepares.
+  /// @return false if the stream can not be read from the packet.
+  virtual bool                 seek (uint64_t number);
+  /// @brief Indexes the packets following the last one indexed from the
+  /// frame headers, without reading the payloads, until indexed returns true.
+  /// @return false if the stream has to be parsed to be indexed.
+  virtual bool                 indexFrames (const std::function<bool ()> &indexed)
+  {
+    (void)indexed;
+    return false;
+  }
+  /// @brief Sets info to the description of the stream read so far.
+  /// @return false if the stream has not been described yet.
+  virtual bool                 streamInfo (ESEStreamInfo *info)
+  {
+    (void)info;
+    return false;
+  }
 
   /// @brief Returns the frame count.
   /// @return
-  int frameCount () { return m_frameCount; }
+  int64_t frameCount () { return static_cast<int64_t> (m_frameCount); }
 
   protected:
   std::unique_ptr<ESEReader> m_reader;
 
-  virtual ESEBuffer getStartCode () { return {}; }
+  virtual ESEBufferView getStartCode () { return ESEBufferView (); }
+
+  bool   prepareReader ();
+  size_t readAheadBlocks ();
 
   // Prepare the next frame available from the given buffer at given position.
-  ESEBuffer  prepareFrame (ESEBuffer buffer, size_t start, size_t end);
-  ESEPacket *prepareNextPacket (uint64_t pts = 0, uint64_t dts = 0, uint64_t duration = 0);
+  // The frame storage is reused.
+  void       prepareFrame (ESEBufferView buffer, size_t start, size_t end, ESEBuffer &frame);
+  // Prepare the next packet with the payload of frame, which is swapped with
+  // the storage of the previous packet.
+  void prepareNextPacket (ESEBuffer &frame, uint64_t pts = 0, uint64_t dts = 0, uint64_t duration = 0);
+  // Prepare a packet pointing to data, kept valid by a reference on storage.
+  void prepareBorrowedPacket (ESEBufferView data, const std::shared_ptr<const uint8_t> &storage);
+  // Prepare a packet made of slices pointing to frame, which is swapped as in
+  // prepareNextPacket, or to storage.
+  void prepareGatheredPacket (ESEBuffer &frame, const std::vector<ESESlice> &slices, const std::shared_ptr<const uint8_t> &storage);
+  // Prepare a packet without payload, only described by its descriptor.
+  void prepareEmptyPacket (uint64_t pts = 0, uint64_t dts = 0, uint64_t duration = 0);
+  // Describe the location of the packet prepared last and record it in the index.
+  void indexPacket (uint64_t offset, uint64_t size, uint32_t type, bool keyframe);
+  // Drop the frames and the packet in progress, the packet number being the
+  // next one prepared.
+  void prepareSeek (uint64_t number);
 
   ESEVideoCodec                      m_codec;
   ESEVideoFormat                     m_format;
   std::map<std::string, std::string> m_options;
   bool                               m_eos;
   ESEBuffer                          m_buffer;
-  uint32_t                           m_bufferPosition;
+  size_t                             m_bufferPosition;
   ESEBuffer                          m_currentFrame;
-  uint32_t                           m_frameCount;
-  ESEPacket                         *m_currentPacket;
-  ESEPacket                         *m_nextPacket;
+  uint64_t                           m_frameCount;
+  std::shared_ptr<ESEPacketPool>     m_packetPool;
+  // The packet is only built when read, from m_packetSlices.
+  bool                               m_packetReady;
+  ESEBuffer                          m_packetFrame;
+  std::vector<ESESlice>              m_packetSlices;
+  std::shared_ptr<const uint8_t>     m_packetStorage;
+  ESEPacketInfo                      m_packetInfo;
+  ESEPacketDescriptor                m_packetDescriptor;
+  std::shared_ptr<ESEIndex>          m_index;
+  // With packet-data:none, the payloads are not gathered, only described.
+  bool                               m_descriptorOnly;
+  bool                               m_keyframesOnly;
 };
 
 ESEVideoFormat
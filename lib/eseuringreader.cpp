@@ -0,0 +1,343 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <cerrno>
+#include <cstring>
+
+#include "eseuringreader.h"
+
+#ifdef HAVE_IO_URING
+#  include <fcntl.h>
+#  include <linux/io_uring.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <sys/uio.h>
+#  include <unistd.h>
+
+// The rings are shared with the kernel, the raw system calls avoid a
+// dependency on liburing.
+struct ESEUring {
+  int            fd;
+  int            fileFd;
+  void          *sqRing;
+  size_t         sqRingSize;
+  void          *cqRing;
+  size_t         cqRingSize;
+  io_uring_sqe  *sqes;
+  size_t         sqesSize;
+  unsigned      *sqHead;
+  unsigned      *sqTail;
+  unsigned      *sqMask;
+  unsigned      *sqArray;
+  unsigned      *cqHead;
+  unsigned      *cqTail;
+  unsigned      *cqMask;
+  io_uring_cqe  *cqes;
+  struct iovec   iovecs[ESE_URING_QUEUE_DEPTH];
+};
+
+static int
+uring_setup (unsigned entries, io_uring_params *params)
+{
+  return static_cast<int> (syscall (__NR_io_uring_setup, entries, params));
+}
+
+static int
+uring_enter (int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+  return static_cast<int> (syscall (__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+#else
+struct ESEUring {
+};
+#endif
+
+ESEUringReader::ESEUringReader (const char *fileName)
+: ESEFileReader (fileName)
+, m_slots (ESE_URING_QUEUE_DEPTH)
+, m_head (0)
+, m_slotOffset (0)
+, m_nextOffset (0)
+, m_expectedPosition (0)
+{
+}
+
+ESEUringReader::~ESEUringReader ()
+{
+  closeRing ();
+}
+
+bool
+ESEUringReader::prepare ()
+{
+  if (!ESEFileReader::prepare ())
+    return false;
+  if (!m_ring && !setupRing ())
+    INFO ("io_uring is not available, use the file stream");
+  return true;
+}
+
+#ifdef HAVE_IO_URING
+bool
+ESEUringReader::setupRing ()
+{
+  io_uring_params params;
+  ESEUring        ring;
+
+  std::memset (&params, 0, sizeof (params));
+  std::memset (&ring, 0, sizeof (ring));
+  ring.fileFd = open (m_fileName.c_str (), O_RDONLY);
+  if (ring.fileFd < 0)
+    return false;
+  ring.fd = uring_setup (ESE_URING_QUEUE_DEPTH, &params);
+  if (ring.fd < 0) {
+    DBG ("io_uring_setup failed: %s", strerror (errno));
+    close (ring.fileFd);
+    return false;
+  }
+
+  ring.sqRingSize = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+  ring.cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof (io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (ring.cqRingSize > ring.sqRingSize)
+      ring.sqRingSize = ring.cqRingSize;
+    ring.cqRingSize = ring.sqRingSize;
+  }
+  ring.sqRing = mmap (nullptr, ring.sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+    ring.fd, IORING_OFF_SQ_RING);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    ring.cqRing = ring.sqRing;
+  else
+    ring.cqRing = mmap (nullptr, ring.cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+      ring.fd, IORING_OFF_CQ_RING);
+  ring.sqesSize = params.sq_entries * sizeof (io_uring_sqe);
+  void *sqes    = mmap (nullptr, ring.sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+       ring.fd, IORING_OFF_SQES);
+  if (ring.sqRing == MAP_FAILED || ring.cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+    ERR ("Unable to map the io_uring rings");
+    if (ring.sqRing != MAP_FAILED)
+      munmap (ring.sqRing, ring.sqRingSize);
+    if (ring.cqRing != MAP_FAILED && ring.cqRing != ring.sqRing)
+      munmap (ring.cqRing, ring.cqRingSize);
+    if (sqes != MAP_FAILED)
+      munmap (sqes, ring.sqesSize);
+    close (ring.fd);
+    close (ring.fileFd);
+    return false;
+  }
+
+  uint8_t *sq  = static_cast<uint8_t *> (ring.sqRing);
+  uint8_t *cq  = static_cast<uint8_t *> (ring.cqRing);
+  ring.sqes    = static_cast<io_uring_sqe *> (sqes);
+  ring.sqHead  = reinterpret_cast<unsigned *> (sq + params.sq_off.head);
+  ring.sqTail  = reinterpret_cast<unsigned *> (sq + params.sq_off.tail);
+  ring.sqMask  = reinterpret_cast<unsigned *> (sq + params.sq_off.ring_mask);
+  ring.sqArray = reinterpret_cast<unsigned *> (sq + params.sq_off.array);
+  ring.cqHead  = reinterpret_cast<unsigned *> (cq + params.cq_off.head);
+  ring.cqTail  = reinterpret_cast<unsigned *> (cq + params.cq_off.tail);
+  ring.cqMask  = reinterpret_cast<unsigned *> (cq + params.cq_off.ring_mask);
+  ring.cqes    = reinterpret_cast<io_uring_cqe *> (cq + params.cq_off.cqes);
+
+  m_ring             = make_unique<ESEUring> (ring);
+  m_expectedPosition = static_cast<size_t> (-1);
+  DBG ("io_uring ready with %u entries", params.sq_entries);
+  return true;
+}
+
+void
+ESEUringReader::closeRing ()
+{
+  if (!m_ring)
+    return;
+  // The kernel may still write to the slots, wait for every read first.
+  bool drained = drain ();
+  munmap (m_ring->sqes, m_ring->sqesSize);
+  if (m_ring->cqRing != m_ring->sqRing)
+    munmap (m_ring->cqRing, m_ring->cqRingSize);
+  munmap (m_ring->sqRing, m_ring->sqRingSize);
+  close (m_ring->fd);
+  close (m_ring->fileFd);
+  if (drained) {
+    m_ring = nullptr;
+    return;
+  }
+  // The reads whose completion could not be reaped may still write to their
+  // slot and read their iovec, which are leaked.
+  for (Slot &slot : m_slots) {
+    if (slot.inFlight) {
+      slot.data.release ();
+      slot.capacity = 0;
+      slot.expected = 0;
+      slot.inFlight = false;
+    }
+  }
+  m_ring.release ();
+}
+
+void
+ESEUringReader::submit (size_t index)
+{
+  Slot    &slot = m_slots[index];
+  unsigned tail = *m_ring->sqTail;
+  unsigned sqe  = tail & *m_ring->sqMask;
+
+  slot.offset   = m_nextOffset;
+  slot.expected = streamSize () - slot.offset;
+  if (slot.expected > slot.capacity)
+    slot.expected = slot.capacity;
+  slot.result   = 0;
+  slot.inFlight = true;
+  m_nextOffset += slot.expected;
+
+  m_ring->iovecs[index].iov_base = slot.data.get ();
+  m_ring->iovecs[index].iov_len  = slot.expected;
+  io_uring_sqe *entry            = &m_ring->sqes[sqe];
+  std::memset (entry, 0, sizeof (*entry));
+  entry->opcode        = IORING_OP_READV;
+  entry->fd            = m_ring->fileFd;
+  entry->off           = slot.offset;
+  entry->addr          = reinterpret_cast<uint64_t> (&m_ring->iovecs[index]);
+  entry->len           = 1;
+  entry->user_data     = index;
+  m_ring->sqArray[sqe] = sqe;
+  __atomic_store_n (m_ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+}
+
+bool
+ESEUringReader::waitFor (size_t index)
+{
+  while (m_slots[index].inFlight) {
+    unsigned head = *m_ring->cqHead;
+    unsigned tail = __atomic_load_n (m_ring->cqTail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+      // Submit the queued reads and wait for a completion in a single call.
+      unsigned to_submit = *m_ring->sqTail - __atomic_load_n (m_ring->sqHead, __ATOMIC_ACQUIRE);
+      // EAGAIN and EBUSY only mean that the kernel is short of resources
+      // until some completions are reaped.
+      if (uring_enter (m_ring->fd, to_submit, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN
+        && errno != EBUSY) {
+        INFO ("io_uring_enter failed: %s", strerror (errno));
+        return false;
+      }
+      continue;
+    }
+    for (; head != tail; head++) {
+      io_uring_cqe *cqe  = &m_ring->cqes[head & *m_ring->cqMask];
+      Slot         &slot = m_slots[cqe->user_data];
+      slot.result        = cqe->res;
+      slot.inFlight      = false;
+    }
+    __atomic_store_n (m_ring->cqHead, head, __ATOMIC_RELEASE);
+  }
+  return true;
+}
+
+bool
+ESEUringReader::drain ()
+{
+  for (size_t i = 0; i < m_slots.size (); i++) {
+    if (!waitFor (i))
+      return false;
+  }
+  return true;
+}
+
+void
+ESEUringReader::restart (size_t position)
+{
+  size_t capacity = bufferReadLength () > ESE_URING_BLOCK_SIZE ? bufferReadLength () : ESE_URING_BLOCK_SIZE;
+
+  // The slots are only reused once their reads are complete.
+  if (!drain ()) {
+    closeRing ();
+    return;
+  }
+  m_head       = 0;
+  m_slotOffset = 0;
+  m_nextOffset = position;
+  for (size_t i = 0; i < m_slots.size (); i++) {
+    Slot &slot = m_slots[i];
+    if (slot.capacity != capacity) {
+      slot.data.reset (new uint8_t[capacity]);
+      slot.capacity = capacity;
+    }
+    slot.inFlight = false;
+    slot.expected = 0;
+    if (m_nextOffset < streamSize ())
+      submit (i);
+  }
+  DBG ("Queue %zd reads of %zd bytes from pos %zd", m_slots.size (), capacity, position);
+}
+
+size_t
+ESEUringReader::readChunk (uint8_t *data, size_t size, int64_t pos)
+{
+  size_t position  = static_cast<size_t> (pos);
+  size_t read_size = 0;
+
+  if (!m_ring)
+    return ESEFileReader::readChunk (data, size, pos);
+
+  if (position != m_expectedPosition)
+    restart (position);
+  if (!m_ring)
+    return ESEFileReader::readChunk (data, size, pos);
+
+  while (read_size < size && position + read_size < streamSize ()) {
+    Slot &slot = m_slots[m_head];
+    if (!slot.expected || !waitFor (m_head) || slot.result != static_cast<int32_t> (slot.expected)) {
+      // Failed or short read: continue synchronously with the file stream.
+      INFO ("io_uring read failed (%d), use the file stream", slot.result);
+      closeRing ();
+      return read_size + ESEFileReader::readChunk (data + read_size, size - read_size, static_cast<int64_t> (position + read_size));
+    }
+    size_t copy_size = slot.expected - m_slotOffset;
+    if (copy_size > size - read_size)
+      copy_size = size - read_size;
+    std::memcpy (data + read_size, slot.data.get () + m_slotOffset, copy_size);
+    read_size += copy_size;
+    m_slotOffset += copy_size;
+    if (m_slotOffset == slot.expected) {
+      // Refill the consumed slot at the end of the queue.
+      slot.expected = 0;
+      if (m_nextOffset < streamSize ())
+        submit (m_head);
+      m_slotOffset = 0;
+      m_head       = (m_head + 1) % m_slots.size ();
+    }
+  }
+  m_expectedPosition = position + read_size;
+  return read_size;
+}
+#else
+bool
+ESEUringReader::setupRing ()
+{
+  return false;
+}
+
+void
+ESEUringReader::closeRing ()
+{
+}
+
+size_t
+ESEUringReader::readChunk (uint8_t *data, size_t size, int64_t pos)
+{
+  return ESEFileReader::readChunk (data, size, pos);
+}
+#endif
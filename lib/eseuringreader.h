@@ -0,0 +1,70 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "esefilereader.h"
+
+#define ESE_URING_QUEUE_DEPTH 8
+#define ESE_URING_BLOCK_SIZE (128 * 1024)
+
+struct ESEUring;
+
+/// @brief File reader keeping several reads in flight with io_uring.
+/// ESE_URING_QUEUE_DEPTH reads of at least ESE_URING_BLOCK_SIZE bytes are
+/// queued at increasing offsets and refilled as they are consumed. When
+/// io_uring is not available at build or run time, the reader behaves as
+/// ESEFileReader.
+class ESEUringReader : public ESEFileReader {
+  public:
+  ESEUringReader (const char *fileName);
+  ~ESEUringReader ();
+
+  virtual bool   prepare ();
+  /// @brief Reads without the ring, whose reads in flight are kept.
+  virtual size_t readAt (uint8_t *data, size_t size, int64_t pos) { return ESEFileReader::readChunk (data, size, pos); }
+
+  protected:
+  virtual size_t readChunk (uint8_t *data, size_t size, int64_t pos);
+
+  private:
+  struct Slot {
+    std::unique_ptr<uint8_t[]> data;
+    size_t                     capacity;
+    size_t                     offset;
+    size_t                     expected;
+    int32_t                    result;
+    bool                       inFlight;
+  };
+
+  bool setupRing ();
+  void closeRing ();
+  void submit (size_t index);
+  bool waitFor (size_t index);
+  bool drain ();
+  void restart (size_t position);
+
+  std::unique_ptr<ESEUring> m_ring;
+  std::vector<Slot>         m_slots;
+  size_t                    m_head;
+  size_t                    m_slotOffset;
+  size_t                    m_nextOffset;
+  size_t                    m_expectedPosition;
+};
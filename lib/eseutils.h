@@ -46,6 +46,49 @@ make_unique (Args &&...args)
     return;                          \
   }
 
+/// @brief Non-owning view on a range of bytes, such as a part of an ESEBuffer.
+/// The viewed bytes must outlive the view.
+class ESEBufferView {
+  public:
+  ESEBufferView ()
+  : m_data (nullptr)
+  , m_size (0)
+  {
+  }
+  ESEBufferView (const uint8_t *data, size_t size)
+  : m_data (data)
+  , m_size (size)
+  {
+  }
+  ESEBufferView (const std::vector<uint8_t> &buffer)
+  : m_data (buffer.data ())
+  , m_size (buffer.size ())
+  {
+  }
+
+  const uint8_t *data () const { return m_data; }
+  size_t         size () const { return m_size; }
+  bool           empty () const { return !m_size; }
+  const uint8_t *begin () const { return m_data; }
+  const uint8_t *end () const { return m_data + m_size; }
+
+  const uint8_t &operator[] (size_t pos) const { return m_data[pos]; }
+
+  /// @brief Returns the view of up to size bytes from pos.
+  ESEBufferView subView (size_t pos, size_t size) const
+  {
+    if (pos > m_size)
+      pos = m_size;
+    if (size > m_size - pos)
+      size = m_size - pos;
+    return ESEBufferView (m_data + pos, size);
+  }
+
+  private:
+  const uint8_t *m_data;
+  size_t         m_size;
+};
+
 template <typename T>
 static inline std::vector<T>
 subVector (std::vector<T> const &v, size_t pos, size_t size)
@@ -17,25 +17,36 @@
 #include <cassert>
 
 #include "eseannexbstream.h"
+#include "eseborrowreader.h"
 #include "eseivfstream.h"
 #include "eselogger.h"
 #include "esenalstream.h"
+#include "esepacketpool.h"
+#include "esepushreader.h"
 #include "eseutils.h"
 #include "esextractor.h"
 
 struct ESExtractor {
 
   ESExtractor ()
+  : m_pushReader (nullptr)
+  , m_packetPool (std::make_shared<ESEPacketPool> ())
+  , m_index (std::make_shared<ESEIndex> ())
+  , m_pendingResult (ESE_RESULT_NEW_PACKET)
   {
   }
 
   ESEVideoFormat format ()
   {
+    if (!m_stream)
+      return ESE_VIDEO_FORMAT_UNKNOWN;
     return m_stream->format ();
   }
 
   ESEVideoCodec codec ()
   {
+    if (!m_stream)
+      return ESE_VIDEO_CODEC_UNKNOWN;
     return m_stream->codec ();
   }
 
@@ -57,8 +68,10 @@ struct ESExtractor {
     };
   }
 
-  int packetCount ()
+  int64_t packetCount ()
   {
+    if (!m_stream)
+      return 0;
     return m_stream->frameCount ();
   }
 
@@ -67,19 +80,128 @@ struct ESExtractor {
     return m_stream->currentPacket ();
   }
 
+  bool readPacketInto (uint8_t *data, size_t capacity, ESEPacketInfo *info)
+  {
+    return m_stream->readPacketInto (data, capacity, info);
+  }
+
+  const std::vector<ESESlice> &readPacketSlices (ESEPacketInfo *info)
+  {
+    return m_stream->readPacketSlices (info);
+  }
+
+  ESEResult readPacketDescriptor (ESEPacketDescriptor *descriptor)
+  {
+    ESEResult res = processToNextPacket ();
+    if (res < ESE_RESULT_EOS) {
+      *descriptor = m_stream->packetDescriptor ();
+      m_stream->skipPacket ();
+    }
+    return res;
+  }
+
+  bool fetchPayload (const ESEPacketDescriptor *descriptor, uint8_t *data)
+  {
+    // The pushed data is released once parsed.
+    if (!m_stream || m_pushReader) {
+      ERR ("Only a stream read through the extractor can be read again");
+      return false;
+    }
+    return m_stream->readPayload (*descriptor, data);
+  }
+
+  ESEResult readPackets (ESEPacket **packets, size_t max, size_t *count)
+  {
+    ESEResult res = m_pendingResult;
+
+    *count          = 0;
+    m_pendingResult = ESE_RESULT_NEW_PACKET;
+    if (res == ESE_RESULT_ERROR)
+      return res;
+    while (*count < max) {
+      res = processToNextPacket ();
+      if (res >= ESE_RESULT_EOS)
+        break;
+      packets[*count] = m_stream->currentPacket ();
+      if (!packets[*count]) {
+        res = ESE_RESULT_ERROR;
+        break;
+      }
+      (*count)++;
+      if (res == ESE_RESULT_LAST_PACKET)
+        return res;
+    }
+    if (!*count)
+      return res;
+    // The packets are returned first, then the end of the batch.
+    if (res == ESE_RESULT_ERROR)
+      m_pendingResult = res;
+    return ESE_RESULT_NEW_PACKET;
+  }
+
   ESEResult processToNextPacket ()
   {
-    return m_stream->processToNextFrame ();
+    if (!m_stream) {
+      ESEResult res = preparePushedStream ();
+      if (res != ESE_RESULT_NEW_PACKET)
+        return res;
+    }
+    ESEResult res = processToNextFrame ();
+    // With filter:keyframes, the other packets are skipped.
+    while (m_stream->keyframesOnly () && res < ESE_RESULT_EOS && !m_stream->isKeyframePacket (m_stream->packetDescriptor ())) {
+      m_stream->skipPacket ();
+      if (res == ESE_RESULT_LAST_PACKET)
+        return ESE_RESULT_EOS;
+      res = skipToKeyframe ();
+    }
+    return res;
   }
 
-  bool prepare (const char *uri, const char *options)
+  /// @brief Prepares the next packet of the stream, filtered or not.
+  ESEResult processToNextFrame ()
   {
-    ESEVideoFormat format = ESE_VIDEO_FORMAT_UNKNOWN;
+    ESEResult res = m_stream->processToNextFrame ();
+    if (res == ESE_RESULT_LAST_PACKET || res == ESE_RESULT_EOS)
+      m_index->finish (static_cast<uint64_t> (m_stream->frameCount ()));
+    return res;
+  }
 
-    m_stream = make_unique<ESEStream> ();
-    if (m_stream->prepare (uri, options))
-      format = ese_stream_probe_video_format (m_stream.get ());
+  /// @brief Returns the number of the first key frame packet of the index
+  /// from number, or -1 if none is indexed.
+  int64_t findKeyframePacket (uint64_t number)
+  {
+    for (; number < m_index->size (); number++) {
+      if (m_stream->isKeyframePacket (m_index->entry (number)))
+        return static_cast<int64_t> (number);
+    }
+    return -1;
+  }
 
+  /// @brief Moves the stream to the next key frame packet and prepares it
+  /// when the index locates it, or prepares the next packet otherwise. An IVF
+  /// index is completed up to the key frame from the frame headers.
+  ESEResult skipToKeyframe ()
+  {
+    if (m_uri.empty ())
+      return processToNextFrame ();
+    uint64_t number = nextPacket ();
+    int64_t  found  = findKeyframePacket (number);
+    if (found < 0 && !m_index->complete ()) {
+      m_stream->indexFrames ([this, number] () {
+        uint64_t size = m_index->size ();
+        return size > number && m_stream->isKeyframePacket (m_index->entry (size - 1));
+      });
+      found = findKeyframePacket (number);
+    }
+    if (found < 0)
+      return m_index->complete () ? ESE_RESULT_EOS : processToNextFrame ();
+    if (static_cast<uint64_t> (found) > number && !m_stream->seek (static_cast<uint64_t> (found)))
+      return ESE_RESULT_ERROR;
+    return processToNextFrame ();
+  }
+
+  void createStream (ESEVideoFormat format)
+  {
     m_stream = nullptr;
     if (format == ESE_VIDEO_FORMAT_NAL) {
       m_stream = make_unique<ESENALStream> ();
@@ -88,47 +210,311 @@ struct ESExtractor {
     } else if (format == ESE_VIDEO_FORMAT_ANNEX_B) {
       m_stream = make_unique<ESEAnnexBStream> ();
     }
+    if (m_stream) {
+      m_stream->setPacketPool (m_packetPool);
+      // Only the files can be indexed, as the pushed data can not be read again.
+      if (!m_uri.empty ())
+        m_stream->setIndex (m_index);
+    }
+  }
+
+  bool indexIdentity (ESEIndexIdentity *identity)
+  {
+    if (m_uri.empty () || !ese_index_file_identity (m_uri, identity))
+      return false;
+    identity->format    = static_cast<uint32_t> (m_stream->format ());
+    identity->codec     = static_cast<uint32_t> (m_stream->codec ());
+    identity->alignment = m_stream->packetAlignment ();
+    return true;
+  }
+
+  std::string indexPath ()
+  {
+    std::string path = m_stream->option ("index");
+    return path.empty () ? m_uri + ESE_INDEX_EXTENSION : path;
+  }
+
+  /// @brief Loads the index saved for the file, if any.
+  void loadIndex ()
+  {
+    ESEIndexIdentity identity;
+    if (indexIdentity (&identity))
+      m_index->load (indexPath (), identity);
+  }
+
+  /// @brief Returns the number of the next packet read.
+  uint64_t nextPacket ()
+  {
+    uint64_t count = static_cast<uint64_t> (m_stream->frameCount ());
+    return m_stream->hasPacket () ? count - 1 : count;
+  }
+
+  /// @brief Moves the stream to the indexed packet number and prepares it.
+  bool moveTo (uint64_t number)
+  {
+    m_pendingResult = ESE_RESULT_NEW_PACKET;
+    return m_stream->seek (number) && processToNextFrame () < ESE_RESULT_EOS;
+  }
+
+  /// @brief Indexes the packets until indexed returns true or the index is
+  /// complete. The stream is moved unless it can index its frame headers.
+  void indexUntil (const std::function<bool ()> &indexed)
+  {
+    if (indexed () || m_index->complete () || m_stream->indexFrames (indexed))
+      return;
+    // The packets are only recorded from the last one indexed, the stream is
+    // parsed from it without reading the payloads.
+    if (static_cast<uint64_t> (m_stream->frameCount ()) < m_index->size () && !moveTo (m_index->size () - 1))
+      return;
+    while (!indexed () && processToNextFrame () < ESE_RESULT_EOS)
+      m_stream->skipPacket ();
+  }
+
+  int64_t buildIndex ()
+  {
+    if (!m_stream)
+      return -1;
+    if (!m_index->complete ()) {
+      if (m_uri.empty ()) {
+        ERR ("Only a file stream can be indexed");
+        return -1;
+      }
+      uint64_t next = nextPacket ();
+      indexUntil ([] () { return false; });
+      // Go back to the next packet, if the stream was parsed past it.
+      if (next < m_index->size () && nextPacket () != next)
+        moveTo (next);
+    }
+    if (!m_index->complete ()) {
+      ERR ("Unable to index the stream");
+      return -1;
+    }
+    return static_cast<int64_t> (m_index->size ());
+  }
+
+  bool seekPacket (int64_t number)
+  {
+    if (!m_stream || m_uri.empty ()) {
+      ERR ("Only a file stream can seek");
+      return false;
+    }
+    uint64_t next = nextPacket ();
+    if (number >= 0)
+      indexUntil ([this, number] () { return m_index->size () > static_cast<uint64_t> (number); });
+    if (number < 0 || static_cast<uint64_t> (number) >= m_index->size ()) {
+      ERR ("The stream has no packet %" PRId64, number);
+      // Go back to the next packet, if the stream was parsed past it.
+      if (next < m_index->size () && nextPacket () != next)
+        moveTo (next);
+      return false;
+    }
+    return moveTo (static_cast<uint64_t> (number));
+  }
 
+  bool seekTime (uint64_t pts, uint32_t flags)
+  {
+    if (!m_stream || m_uri.empty () || format () != ESE_VIDEO_FORMAT_IVF) {
+      ERR ("Only an IVF file stream can seek to a time");
+      return false;
+    }
+    // The packets are indexed up to the first one following pts.
+    indexUntil ([this, pts] () { return m_index->size () && m_index->entry (m_index->size () - 1).pts > pts; });
+    if (!m_index->size ())
+      return false;
+    int64_t  found  = m_index->findTime (pts);
+    uint64_t number = found < 0 ? 0 : static_cast<uint64_t> (found);
+    if (!(flags & ESE_SEEK_FLAG_ANY))
+      number = m_index->findKeyframe (number);
+    return moveTo (number);
+  }
+
+  bool saveIndex (const char *path)
+  {
+    ESEIndexIdentity identity;
+
+    if (!m_stream || !indexIdentity (&identity)) {
+      ERR ("Only the index of a file can be saved");
+      return false;
+    }
+    if (buildIndex () < 0)
+      return false;
+    return m_index->save (path ? std::string (path) : indexPath (), identity);
+  }
+
+  bool streamInfo (ESEStreamInfo *info)
+  {
+    if (!m_stream || m_stream->streamInfo (info))
+      return m_stream != nullptr;
+    if (m_uri.empty ())
+      return false;
+    // The parameter sets are parsed from the next packet, then the stream
+    // goes back to it.
+    uint64_t next = nextPacket ();
+    while (!m_stream->streamInfo (info) && processToNextFrame () < ESE_RESULT_EOS)
+      m_stream->skipPacket ();
+    if (next < m_index->size () && nextPacket () != next)
+      moveTo (next);
+    return m_stream->streamInfo (info);
+  }
+
+  bool packetDescriptor (int64_t number, ESEPacketDescriptor *descriptor)
+  {
+    if (number < 0 || static_cast<uint64_t> (number) >= m_index->size ())
+      return false;
+    *descriptor = m_index->entry (static_cast<uint64_t> (number));
+    return true;
+  }
+
+  bool prepare (const char *uri, const char *options)
+  {
+    ESEVideoFormat format = ESE_VIDEO_FORMAT_UNKNOWN;
+
+    m_uri    = uri ? uri : "";
+    m_stream = make_unique<ESEStream> ();
+    if (m_stream->prepare (uri, options))
+      format = ese_stream_probe_video_format (m_stream.get ());
+
+    createStream (format);
     if (m_stream && m_stream->prepare (uri, options)) {
+      loadIndex ();
       return (m_stream->processToNextFrame () <= ESE_RESULT_ERROR);
     }
     return false;
   }
 
-  bool prepare_data (ese_read_buffer_func func, void *data, const char *options)
+  template <typename ReadFunc>
+  bool prepare_data (ReadFunc func, void *data, const char *options)
   {
     ESEVideoFormat format = ESE_VIDEO_FORMAT_UNKNOWN;
 
     m_stream = make_unique<ESEStream> ();
     if (m_stream->prepare (func, data, options))
       format = ese_stream_probe_video_format (m_stream.get ());
-    m_stream = nullptr;
-    if (format == ESE_VIDEO_FORMAT_NAL) {
-      m_stream = make_unique<ESENALStream> ();
-    } else if (format == ESE_VIDEO_FORMAT_IVF) {
-      m_stream = make_unique<ESEIVFStream> ();
-    } else if (format == ESE_VIDEO_FORMAT_ANNEX_B) {
-      m_stream = make_unique<ESEAnnexBStream> ();
-    }
+    createStream (format);
     if (m_stream && m_stream->prepare (func, data, options)) {
       return (m_stream->processToNextFrame () <= ESE_RESULT_ERROR);
     }
     return false;
   }
 
+  /// @brief Probes the stream and prepares the final one with the same reader.
+  bool prepareWithReader (std::unique_ptr<ESEReader> reader, const std::string &options)
+  {
+    ESEVideoFormat format = ESE_VIDEO_FORMAT_UNKNOWN;
+
+    m_stream = make_unique<ESEStream> ();
+    if (m_stream->prepare (std::move (reader), options.c_str ()))
+      format = ese_stream_probe_video_format (m_stream.get ());
+    reader = m_stream->releaseReader ();
+
+    createStream (format);
+    if (!m_stream)
+      return false;
+    return m_stream->prepare (std::move (reader), options.c_str ());
+  }
+
+  bool prepareBorrow (ese_borrow_buffer_func borrow_func, ese_release_buffer_func release_func, void *data, const char *options)
+  {
+    if (!prepareWithReader (make_unique<ESEBorrowReader> (borrow_func, release_func, data), options ? options : ""))
+      return false;
+    return (m_stream->processToNextFrame () <= ESE_RESULT_ERROR);
+  }
+
+  bool preparePush (const char *options)
+  {
+    std::unique_ptr<ESEPushReader> reader = make_unique<ESEPushReader> ();
+
+    if (options)
+      m_pushOptions = options;
+    m_pushReader   = reader.get ();
+    m_pushedReader = std::move (reader);
+    return m_pushReader->prepare ();
+  }
+
+  /// @brief Probes the pushed data and prepares the stream once enough data
+  /// is available.
+  ESEResult preparePushedStream ()
+  {
+    if (!m_pushedReader)
+      return ESE_RESULT_ERROR;
+    if (m_pushReader->isLive () && m_pushReader->pushedSize () < ESE_PUSH_PROBE_SIZE)
+      return ESE_RESULT_NO_PACKET;
+    if (!m_pushReader->isLive () && !m_pushReader->pushedSize ())
+      return ESE_RESULT_EOS;
+
+    if (!prepareWithReader (std::move (m_pushedReader), m_pushOptions)) {
+      ERR ("Unable to find the format of the pushed stream");
+      m_pushReader = nullptr;
+      return ESE_RESULT_ERROR;
+    }
+    return ESE_RESULT_NEW_PACKET;
+  }
+
+  void pushData (const uint8_t *data, size_t size)
+  {
+    if (!m_pushReader) {
+      ERR ("The extractor does not accept pushed data");
+      return;
+    }
+    m_pushReader->push (data, size);
+  }
+
+  void pushEOS ()
+  {
+    if (!m_pushReader) {
+      ERR ("The extractor does not accept pushed data");
+      return;
+    }
+    m_pushReader->pushEOS ();
+  }
+
+  void setAllocator (ese_alloc_func allocFunc, ese_free_func freeFunc, void *data)
+  {
+    m_packetPool->setAllocator (allocFunc, freeFunc, data);
+  }
+
   void setOptions (const char *options)
   {
+    // The options of a pushed stream apply once its format is known.
+    if (!m_stream) {
+      if (options) {
+        m_pushOptions += "\n";
+        m_pushOptions += options;
+      }
+      return;
+    }
+    // The stream is parsed again from its start, which a pushed stream only
+    // keeps for its first ESE_PUSH_REWIND_SIZE bytes.
+    if (m_pushReader && !m_pushReader->canRewind ()) {
+      ERR ("The start of the pushed stream has been released, the options are not changed");
+      return;
+    }
+    // The packets may differ with the new options.
+    m_index->reset ();
     m_stream->reset ();
     m_stream->setOptions (options);
     m_stream->processToNextFrame ();
+    loadIndex ();
   }
 
   void setBufferReadLength (size_t len)
   {
-    m_stream->setBufferReadLength (len);
+    if (m_stream)
+      m_stream->setBufferReadLength (len);
   }
 
-  std::unique_ptr<ESEStream> m_stream;
+  std::unique_ptr<ESEStream>     m_stream;
+  // The push reader is owned by m_pushedReader until the stream is prepared.
+  ESEPushReader                 *m_pushReader;
+  std::unique_ptr<ESEReader>     m_pushedReader;
+  std::string                    m_pushOptions;
+  // The packets are recycled through es_extractor_clear_packet.
+  std::shared_ptr<ESEPacketPool> m_packetPool;
+  // The locations of the packets, recorded as they are read or loaded.
+  std::shared_ptr<ESEIndex>      m_index;
+  std::string                    m_uri;
+  // The error which ended a batch of packets, returned by the next read.
+  ESEResult                      m_pendingResult;
 };
 
 ESExtractor *
@@ -155,6 +541,58 @@ es_extractor_new_with_read_func (ese_read_buffer_func func, void *data, const ch
   return NULL;
 }
 
+ESExtractor *
+es_extractor_new_with_read_func64 (ese_read_buffer_func64 func, void *data, const char *options)
+{
+  ESExtractor *extractor = new ESExtractor ();
+  if (extractor->prepare_data (func, data, options)) {
+    return extractor;
+  }
+
+  es_extractor_teardown (extractor);
+  return NULL;
+}
+
+ESExtractor *
+es_extractor_new_with_borrow_func (ese_borrow_buffer_func borrow_func, ese_release_buffer_func release_func, void *data, const char *options)
+{
+  ESE_CHECK (borrow_func != NULL, NULL);
+  ESExtractor *extractor = new ESExtractor ();
+  if (extractor->prepareBorrow (borrow_func, release_func, data, options)) {
+    return extractor;
+  }
+
+  es_extractor_teardown (extractor);
+  return NULL;
+}
+
+ESExtractor *
+es_extractor_new_push (const char *options)
+{
+  ESExtractor *extractor = new ESExtractor ();
+  if (extractor->preparePush (options)) {
+    return extractor;
+  }
+
+  es_extractor_teardown (extractor);
+  return NULL;
+}
+
+void
+es_extractor_push_data (ESExtractor *extractor, const uint8_t *data, size_t size)
+{
+  ESE_CHECK_VOID (extractor != NULL);
+  ESE_CHECK_VOID (data != NULL || !size);
+  extractor->pushData (data, size);
+}
+
+void
+es_extractor_push_eos (ESExtractor *extractor)
+{
+  ESE_CHECK_VOID (extractor != NULL);
+  extractor->pushEOS ();
+}
+
 void
 es_extractor_set_options (ESExtractor *extractor, const char *options)
 {
@@ -162,6 +600,14 @@ es_extractor_set_options (ESExtractor *extractor, const char *options)
   extractor->setOptions (options);
 }
 
+void
+es_extractor_set_allocator (ESExtractor *extractor, ese_alloc_func alloc_func, ese_free_func free_func, void *data)
+{
+  ESE_CHECK_VOID (extractor != NULL);
+  ESE_CHECK_VOID ((alloc_func != NULL) == (free_func != NULL));
+  extractor->setAllocator (alloc_func, free_func, data);
+}
+
 ESEResult
 es_extractor_read_packet (ESExtractor *extractor, ESEPacket **packet)
 {
@@ -171,10 +617,106 @@ es_extractor_read_packet (ESExtractor *extractor, ESEPacket **packet)
     *packet = extractor->currentPacket ();
   else
     *packet = nullptr;
+  // The allocator of the application failed.
+  if (res < ESE_RESULT_EOS && !*packet)
+    res = ESE_RESULT_ERROR;
+
+  return res;
+}
+
+ESEResult
+es_extractor_read_packets (ESExtractor *extractor, ESEPacket **packets, size_t max, size_t *packet_count)
+{
+  ESE_CHECK (extractor != NULL, ESE_RESULT_ERROR);
+  ESE_CHECK (packet_count != NULL, ESE_RESULT_ERROR);
+  ESE_CHECK (packets != NULL || !max, ESE_RESULT_ERROR);
+  return extractor->readPackets (packets, max, packet_count);
+}
+
+ESEResult
+es_extractor_read_packet_into (ESExtractor *extractor, uint8_t *data, size_t capacity, ESEPacketInfo *info)
+{
+  ESE_CHECK (extractor != NULL, ESE_RESULT_ERROR);
+  ESE_CHECK (info != NULL, ESE_RESULT_ERROR);
+  ESE_CHECK (data != NULL || !capacity, ESE_RESULT_ERROR);
+  ESEResult res = extractor->processToNextPacket ();
+  if (res < ESE_RESULT_EOS && !extractor->readPacketInto (data, capacity, info))
+    res = ESE_RESULT_BUFFER_TOO_SMALL;
+
+  return res;
+}
+
+ESEResult
+es_extractor_read_packet_slices (ESExtractor *extractor, const ESESlice **slices, size_t *slice_count, ESEPacketInfo *info)
+{
+  ESE_CHECK (extractor != NULL, ESE_RESULT_ERROR);
+  ESE_CHECK (slices != NULL && slice_count != NULL && info != NULL, ESE_RESULT_ERROR);
+  ESEResult res = extractor->processToNextPacket ();
+  if (res < ESE_RESULT_EOS) {
+    const std::vector<ESESlice> &packet_slices = extractor->readPacketSlices (info);
+    *slices                                    = packet_slices.data ();
+    *slice_count                               = packet_slices.size ();
+  } else {
+    *slices      = nullptr;
+    *slice_count = 0;
+  }
 
   return res;
 }
 
+ESEResult
+es_extractor_read_packet_descriptor (ESExtractor *extractor, ESEPacketDescriptor *descriptor)
+{
+  ESE_CHECK (extractor != NULL, ESE_RESULT_ERROR);
+  ESE_CHECK (descriptor != NULL, ESE_RESULT_ERROR);
+  return extractor->readPacketDescriptor (descriptor);
+}
+
+bool
+es_extractor_fetch_payload (ESExtractor *extractor, const ESEPacketDescriptor *descriptor, uint8_t *data)
+{
+  ESE_CHECK (extractor != NULL, false);
+  ESE_CHECK (descriptor != NULL, false);
+  ESE_CHECK (data != NULL || !descriptor->size, false);
+  return extractor->fetchPayload (descriptor, data);
+}
+
+int64_t
+es_extractor_build_index (ESExtractor *extractor)
+{
+  ESE_CHECK (extractor != NULL, -1);
+  return extractor->buildIndex ();
+}
+
+bool
+es_extractor_save_index (ESExtractor *extractor, const char *path)
+{
+  ESE_CHECK (extractor != NULL, false);
+  return extractor->saveIndex (path);
+}
+
+bool
+es_extractor_packet_descriptor (ESExtractor *extractor, int64_t number, ESEPacketDescriptor *descriptor)
+{
+  ESE_CHECK (extractor != NULL, false);
+  ESE_CHECK (descriptor != NULL, false);
+  return extractor->packetDescriptor (number, descriptor);
+}
+
+bool
+es_extractor_seek_packet (ESExtractor *extractor, int64_t number)
+{
+  ESE_CHECK (extractor != NULL, false);
+  return extractor->seekPacket (number);
+}
+
+bool
+es_extractor_seek_time (ESExtractor *extractor, uint64_t pts, uint32_t flags)
+{
+  ESE_CHECK (extractor != NULL, false);
+  return extractor->seekTime (pts, flags);
+}
+
 ESEVideoCodec
 es_extractor_video_codec (ESExtractor *extractor)
 {
@@ -196,8 +738,23 @@ es_extractor_video_codec_name (ESExtractor *extractor)
   return extractor->codec_name ();
 }
 
+bool
+es_extractor_stream_info (ESExtractor *extractor, ESEStreamInfo *info)
+{
+  ESE_CHECK (extractor != NULL, false);
+  ESE_CHECK (info != NULL, false);
+  return extractor->streamInfo (info);
+}
+
 int
 es_extractor_packet_count (ESExtractor *extractor)
+{
+  ESE_CHECK (extractor != NULL, -1);
+  return static_cast<int> (extractor->packetCount ());
+}
+
+int64_t
+es_extractor_packet_count64 (ESExtractor *extractor)
 {
   ESE_CHECK (extractor != NULL, -1);
   return extractor->packetCount ();
@@ -206,10 +763,8 @@ es_extractor_packet_count (ESExtractor *extractor)
 void
 es_extractor_clear_packet (ESEPacket *pkt)
 {
-  if (pkt) {
-    std::free (pkt->data);
-    delete pkt;
-  }
+  if (pkt)
+    ESEPacketPool::release (pkt);
 }
 
 void
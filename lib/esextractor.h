@@ -20,6 +20,18 @@
 #include <cstdint>
 
 typedef size_t (*ese_read_buffer_func) (void *opaque, unsigned char *buffer, size_t buffer_size, int32_t offset);
+typedef size_t (*ese_read_buffer_func64) (void *opaque, unsigned char *buffer, size_t buffer_size, int64_t offset);
+/// @brief Lends the application memory holding the stream from offset.
+/// Sets buffer to the data and returns its size, which can be more or less
+/// than the buffer_size hint, or 0 at the end of the stream.
+typedef size_t (*ese_borrow_buffer_func) (void *opaque, const unsigned char **buffer, size_t buffer_size, int64_t offset);
+/// @brief Gives back a buffer lent by ese_borrow_buffer_func.
+typedef void (*ese_release_buffer_func) (void *opaque, const unsigned char *buffer);
+/// @brief Allocates size bytes of packet memory, aligned as malloc does, or
+/// returns NULL on failure.
+typedef void *(*ese_alloc_func) (void *opaque, size_t size);
+/// @brief Frees the memory returned by ese_alloc_func.
+typedef void (*ese_free_func) (void *opaque, void *data);
 #define ESEBuffer std::vector<unsigned char>
 
 typedef enum ESEVideoCodec {
@@ -45,8 +57,27 @@ typedef enum _ESEResult {
   ESE_RESULT_EOS,
   ESE_RESULT_NO_PACKET,
   ESE_RESULT_ERROR,
+  ESE_RESULT_BUFFER_TOO_SMALL,
 } ESEResult;
 
+/// @brief Flags of es_extractor_seek_time.
+typedef enum _ESESeekFlags {
+  /// Seek to the key frame at or before the time, the packets can be decoded from it.
+  ESE_SEEK_FLAG_KEYFRAME = 0,
+  /// Seek to the packet at or before the time, key frame or not.
+  ESE_SEEK_FLAG_ANY = 1 << 0,
+} ESESeekFlags;
+
+/// @brief Packet returned by es_extractor_read_packet.
+/// With the "packet-data:borrow" option, the NALs of a mapped file are not
+/// copied: data points to the file mapping, with the start code of the stream,
+/// and stays valid until es_extractor_clear_packet. The access units are
+/// still gathered into a copy, es_extractor_read_packet_slices avoids it.
+/// With the "packet-data:none" option, the payloads are not read at all and
+/// the packets are empty, see es_extractor_read_packet_descriptor.
+/// packet_number is the number of the packet in the stream, from 0. It wraps
+/// past 2^31 packets: the 64-bit number is set in ESEPacketInfo by
+/// es_extractor_read_packet_into and es_extractor_read_packet_slices.
 typedef struct _ESEPacket {
   uint8_t *data;
   size_t   data_size;
@@ -56,6 +87,59 @@ typedef struct _ESEPacket {
   uint64_t duration;
 } ESEPacket;
 
+/// @brief Description of a packet written by es_extractor_read_packet_into.
+/// packet_number is the number of the packet in the stream, from 0.
+typedef struct _ESEPacketInfo {
+  size_t   data_size;
+  uint64_t pts;
+  uint64_t dts;
+  uint64_t duration;
+  uint64_t packet_number;
+} ESEPacketInfo;
+
+/// @brief The packet starts a key frame, or is an IDR or IRAP NAL.
+#define ESE_PACKET_FLAG_KEYFRAME 0x1
+
+/// @brief Location of a packet in the stream, as recorded in the index.
+/// The payload of an IVF or an Annex B packet is its frame data. A NAL or an
+/// access unit spans its NALs, with the start codes of the stream: the AUD
+/// which starts the access unit packets is not part of it.
+typedef struct _ESEPacketDescriptor {
+  uint64_t offset;
+  uint64_t size;
+  uint64_t pts;
+  /// NAL type of a NAL, of the last NAL of an access unit, 0 otherwise.
+  uint32_t type;
+  uint32_t flags;
+} ESEPacketDescriptor;
+
+/// @brief Part of a packet returned by es_extractor_read_packet_slices, as an iovec.
+typedef struct _ESESlice {
+  const uint8_t *data;
+  size_t         size;
+} ESESlice;
+
+/// @brief Description of the stream returned by es_extractor_stream_info.
+/// The fields which the stream does not describe are 0.
+typedef struct _ESEStreamInfo {
+  ESEVideoCodec codec;
+  /// Size of the pictures, after the cropping window.
+  uint32_t width;
+  uint32_t height;
+  /// profile_idc and level_idc in H.264, general_profile_idc and
+  /// general_level_idc in H.265.
+  uint32_t profile;
+  uint32_t level;
+  /// chroma_format_idc: 0 for monochrome, 1 for 4:2:0, 2 for 4:2:2 and 3 for 4:4:4.
+  uint32_t chroma_format;
+  uint32_t bit_depth_luma;
+  uint32_t bit_depth_chroma;
+  /// Timing of the VUI or of the IVF header: a tick lasts num_units_in_tick
+  /// / time_scale seconds.
+  uint32_t num_units_in_tick;
+  uint32_t time_scale;
+} ESEStreamInfo;
+
 #if (defined _WIN32 || defined __CYGWIN__) && !defined(ES_STATIC_COMPILATION)
 #  ifdef BUILDING_ES_EXTRACTOR
 #    define ES_EXTRACTOR_API __declspec (dllexport)
@@ -76,26 +160,164 @@ struct ESExtractor;
 extern "C" {
 #endif
 
+/// @brief Creates an extractor reading the file at uri, or NULL if its format
+/// can not be found. The options are "key:value" lines.
+/// The "reader" option selects how the file is read:
+/// - "mmap", the default, maps the file in memory. A file which can not be
+///   mapped is read as with "file".
+/// - "file" reads it in chunks.
+/// - "uring" keeps several reads in flight with io_uring. It behaves as "file"
+///   when io_uring is not available at build or run time, or once a read
+///   fails.
+/// With the "readahead:N" option, N chunks of the stream are read ahead on a
+/// background thread while the packets are parsed. The file is then read in
+/// chunks instead of being mapped.
 ES_EXTRACTOR_API
 ESExtractor *
 es_extractor_new (const char *uri, const char *options);
 
+/// @brief Creates an extractor reading the stream through func, called with
+/// data.
+/// With the "readahead:N" option, func is called from a background thread of
+/// the extractor, which reads N chunks ahead. func then runs concurrently with
+/// the application thread, and the data it uses must be safe to access from
+/// both. The calls to func are never concurrent with each other, and no call
+/// is in progress once es_extractor_teardown returns.
 ES_EXTRACTOR_API
 ESExtractor *
 es_extractor_new_with_read_func (ese_read_buffer_func func, void *data, const char *options);
 
+/// @brief Same as es_extractor_new_with_read_func, with 64-bit stream offsets
+/// to support streams larger than 2 GiB. func is called from the same threads.
+ES_EXTRACTOR_API
+ESExtractor *
+es_extractor_new_with_read_func64 (ese_read_buffer_func64 func, void *data, const char *options);
+
+/// @brief Same as es_extractor_new_with_read_func, reading the stream straight
+/// from the application memory. A single buffer is borrowed at a time, it is
+/// released before the next one is borrowed and on teardown. The stream is
+/// probed from its start, so offsets can be borrowed again.
+ES_EXTRACTOR_API
+ESExtractor *
+es_extractor_new_with_borrow_func (ese_borrow_buffer_func borrow_func, ese_release_buffer_func release_func, void *data, const char *options);
+
+/// @brief Creates an extractor fed with es_extractor_push_data instead of a
+/// read callback. The format is probed once enough data has been pushed and
+/// es_extractor_read_packet returns ESE_RESULT_NO_PACKET while it waits for data.
+ES_EXTRACTOR_API
+ESExtractor *
+es_extractor_new_push (const char *options);
+
+/// @brief Appends a copy of size bytes of data to the stream of a push extractor.
+ES_EXTRACTOR_API
+void
+es_extractor_push_data (ESExtractor *extractor, const uint8_t *data, size_t size);
+
+/// @brief Signals the end of the stream to a push extractor, the remaining
+/// packets can then be read up to ESE_RESULT_EOS.
+ES_EXTRACTOR_API
+void
+es_extractor_push_eos (ESExtractor *extractor);
+
+/// @brief Applies options to the extractor, whose stream is parsed again from
+/// its start. The options of a push extractor are kept once the start of its
+/// stream has been released, past the first 64 KiB read.
 ES_EXTRACTOR_API
 void
 es_extractor_set_options (ESExtractor *extractor, const char *options);
 
+/// @brief Allocates the memory of the next packets with alloc_func and frees it
+/// with free_func, both called with data, for example to read the packets into
+/// a shared memory region. NULL functions restore the default allocator.
+/// The packet structure is allocated along with its payload, the packets
+/// borrowed from a file mapping only hold the structure. The functions can be
+/// called from the thread clearing the packets, until the last packet
+/// allocated with them is cleared. es_extractor_read_packet returns
+/// ESE_RESULT_ERROR when alloc_func fails, the packet is then returned by the
+/// next read.
+ES_EXTRACTOR_API
+void
+es_extractor_set_allocator (ESExtractor *extractor, ese_alloc_func alloc_func, ese_free_func free_func, void *data);
+
+/// @brief Returns the next packet of the stream, to clear with
+/// es_extractor_clear_packet.
+/// With the "filter:keyframes" option, only the key frames are returned: the
+/// IDR or IRAP access units or NALs, with the parameter set NALs, and the IVF
+/// or Annex B key frames. The packets in between are skipped by seeking when
+/// the index of a file stream locates the next key frame, the IVF index being
+/// completed from the frame headers. The packet numbers are the ones of the
+/// whole stream.
+/// With the "alignment:AU" option, an H.264 or H.265 access unit holds the
+/// NALs of a picture, with the ones preceding it. A picture starts with an
+/// AUD or with the first slice of a new picture: the H.265 base layer slice
+/// whose first_slice_segment_in_pic_flag is set, or the H.264 slice whose
+/// frame_num, picture order count, reference or IDR fields differ from the
+/// previous slice, the slices possibly being in an arbitrary order.
+/// With the "drop-nals" option, a comma separated list of "sei", "filler",
+/// "non-reference" and "layers", these H.264 or H.265 NALs are dropped before
+/// being copied: the SEI, the filler data, the slices of the non-reference
+/// pictures and the NALs of the layers above the base one. The
+/// "max-temporal-id:N" option drops the H.265 NALs whose temporal id is above
+/// N. The first slice of a picture being dropped drops the picture, with the
+/// NALs preceding it in its access unit except the parameter sets. The
+/// packets are numbered and indexed without the dropped NALs.
 ES_EXTRACTOR_API
 ESEResult
 es_extractor_read_packet (ESExtractor *extractor, ESEPacket **pkt);
 
+/// @brief Releases a packet returned by es_extractor_read_packet. Its memory
+/// is kept by the extractor for the next packets, up to the number of bytes set
+/// with the "packet-pool-size" option (32 MiB by default, 0 to disable).
+/// A packet can be released from any thread, including after the teardown.
 ES_EXTRACTOR_API
 void
 es_extractor_clear_packet (ESEPacket *pkt);
 
+/// @brief Same as es_extractor_read_packet, reading up to max packets in a
+/// single call. packet_count is set to the number of packets stored in
+/// packets, each to be cleared by es_extractor_clear_packet.
+/// ESE_RESULT_LAST_PACKET is returned when the batch ends with the last packet
+/// and ESE_RESULT_NEW_PACKET when it holds other packets. A batch stops early
+/// at the end of the stream, on a lack of data or on an error, which is then
+/// returned by the next call if the batch holds packets.
+ES_EXTRACTOR_API
+ESEResult
+es_extractor_read_packets (ESExtractor *extractor, ESEPacket **packets, size_t max, size_t *packet_count);
+
+/// @brief Same as es_extractor_read_packet, writing the payload of the packet
+/// straight to the capacity bytes of data, for example a decoder input buffer.
+/// info receives the packet size and timestamps. If the packet does not fit,
+/// ESE_RESULT_BUFFER_TOO_SMALL is returned with the size needed in info and
+/// the packet is returned by the next read.
+ES_EXTRACTOR_API
+ESEResult
+es_extractor_read_packet_into (ESExtractor *extractor, uint8_t *data, size_t capacity, ESEPacketInfo *info);
+
+/// @brief Same as es_extractor_read_packet, returning the packet as slice_count
+/// slices to gather, without concatenating them. An access unit is made of its
+/// AUD and of one slice per NAL. The slices belong to the extractor and are
+/// valid until the next read or the teardown.
+ES_EXTRACTOR_API
+ESEResult
+es_extractor_read_packet_slices (ESExtractor *extractor, const ESESlice **slices, size_t *slice_count, ESEPacketInfo *info);
+
+/// @brief Same as es_extractor_read_packet, setting descriptor to the location
+/// of the packet in the stream instead of returning its payload. With the
+/// "packet-data:none" option, the payloads are not gathered by the extractor
+/// either: the IVF frames are skipped after their first bytes and the NALs are
+/// only scanned, so the packets can be described without copying them.
+ES_EXTRACTOR_API
+ESEResult
+es_extractor_read_packet_descriptor (ESExtractor *extractor, ESEPacketDescriptor *descriptor);
+
+/// @brief Reads the descriptor->size bytes of the stream located by
+/// descriptor to data, as they are in the stream (see ESEPacketDescriptor).
+/// The next packet read is not changed.
+/// @return false if the bytes can not be read, as for a pushed stream.
+ES_EXTRACTOR_API
+bool
+es_extractor_fetch_payload (ESExtractor *extractor, const ESEPacketDescriptor *descriptor, uint8_t *data);
+
 ES_EXTRACTOR_API
 ESEVideoFormat
 es_extractor_video_format (ESExtractor *extractor);
@@ -108,10 +330,66 @@ ES_EXTRACTOR_API
 const char *
 es_extractor_video_codec_name (ESExtractor *extractor);
 
+/// @brief Sets info to the description of the stream, from the last sequence
+/// parameter set of an H.264 or H.265 stream, or from the IVF header. The
+/// parameter sets are cached as the NALs are read, and searched from the next
+/// packet of a file stream, which is read again afterwards.
+/// @return false if the stream has not been described yet.
+ES_EXTRACTOR_API
+bool
+es_extractor_stream_info (ESExtractor *extractor, ESEStreamInfo *info);
+
+/// @brief Returns the number of packets read from the stream, which is
+/// truncated past 2^31 packets, see es_extractor_packet_count64.
 ES_EXTRACTOR_API
 int
 es_extractor_packet_count (ESExtractor *extractor);
 
+/// @brief Same as es_extractor_packet_count, returning the 64-bit count.
+ES_EXTRACTOR_API
+int64_t
+es_extractor_packet_count64 (ESExtractor *extractor);
+
+/// @brief Indexes the location of every packet of the stream. The index is
+/// recorded while the packets are read in order from the first one, so the
+/// stream is only parsed to index the remaining packets, or only their frame
+/// headers are read for IVF. The next packet read is not changed.
+/// A file stream loads the index saved next to it by es_extractor_save_index,
+/// unless the file changed since, or the file set with the "index" option.
+/// @return the number of packets, or -1 on error.
+ES_EXTRACTOR_API
+int64_t
+es_extractor_build_index (ESExtractor *extractor);
+
+/// @brief Writes the index of a file stream to path, or to the file name
+/// followed by ".eseidx" if null, building it first if needed.
+ES_EXTRACTOR_API
+bool
+es_extractor_save_index (ESExtractor *extractor, const char *path);
+
+/// @brief Sets descriptor to the location of the packet number of the index.
+/// @return false if the packet is not indexed.
+ES_EXTRACTOR_API
+bool
+es_extractor_packet_descriptor (ESExtractor *extractor, int64_t number, ESEPacketDescriptor *descriptor);
+
+/// @brief Moves a file stream to the packet number, the next packet read.
+/// The stream is read from the packet location in the index, which is
+/// completed up to the packet first if needed, so the cost of a seek does
+/// not depend on the packet position once the packet is indexed.
+/// @return false, without moving, if the stream has no such packet.
+ES_EXTRACTOR_API
+bool
+es_extractor_seek_packet (ESExtractor *extractor, int64_t number);
+
+/// @brief Moves a file stream to the packet at or before pts, or to the last
+/// key frame up to it unless flags has ESE_SEEK_FLAG_ANY. A time before the
+/// first packet moves to the first one. Only the IVF packets have timestamps.
+/// @return false, without moving, if the stream can not seek.
+ES_EXTRACTOR_API
+bool
+es_extractor_seek_time (ESExtractor *extractor, uint64_t pts, uint32_t flags);
+
 ES_EXTRACTOR_API
 void
 es_extractor_teardown (ESExtractor *extractor);
@@ -0,0 +1,684 @@
+/* ESExtractor
+ * Copyright (C) 2023 Igalia, S.L.
+ *     Author: Stephane Cerveau <scerveau@igalia.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You
+ * may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+ * implied.  See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "esedatareader.h"
+#include "eseivfstream.h"
+#include "esescan.h"
+
+#define BENCH_STREAM_SIZE (16 * 1024 * 1024)
+#define BENCH_CONSUME_SIZE 1024
+
+class BenchTimer {
+  public:
+  BenchTimer ()
+  : m_start (std::chrono::steady_clock::now ())
+  {
+  }
+  double elapsed ()
+  {
+    return std::chrono::duration<double> (std::chrono::steady_clock::now () - m_start).count ();
+  }
+
+  private:
+  std::chrono::steady_clock::time_point m_start;
+};
+
+static void
+report (const std::string &name, size_t bytes, double seconds)
+{
+  std::cout << "  " << name << ": " << (bytes / seconds) / (1024 * 1024) << " MB/s ("
+            << seconds * 1000 << " ms)" << std::endl;
+}
+
+static ESEBuffer
+make_stream (size_t size)
+{
+  ESEBuffer stream (size);
+  for (size_t i = 0; i < size; i++)
+    stream[i] = static_cast<uint8_t> (i * 7);
+  return stream;
+}
+
+static size_t
+MemoryReadFunc (void *opaque, unsigned char *buffer, size_t size, int32_t offset)
+{
+  const ESEBuffer *stream   = static_cast<const ESEBuffer *> (opaque);
+  size_t           position = static_cast<size_t> (offset);
+  if (position >= stream->size ())
+    return 0;
+  if (position + size > stream->size ())
+    size = stream->size () - position;
+  std::memcpy (buffer, stream->data () + position, size);
+  return size;
+}
+
+/// @brief Reference implementation of the former reader buffer: read to a
+/// fresh zeroed vector, append it and erase the consumed bytes at the front.
+static size_t
+bench_vector_reader (const ESEBuffer &stream, size_t read_length)
+{
+  ESEBuffer buffer;
+  size_t    position = 0, total = 0;
+
+  while (true) {
+    while (buffer.size () < BENCH_CONSUME_SIZE) {
+      ESEBuffer chunk;
+      chunk.resize (read_length);
+      size_t read_size = MemoryReadFunc (const_cast<ESEBuffer *> (&stream), chunk.data (), read_length, static_cast<int32_t> (position));
+      chunk.resize (read_size);
+      position += read_size;
+      buffer.insert (buffer.end (), chunk.begin (), chunk.end ());
+      if (read_size < read_length)
+        break;
+    }
+    size_t    real_size = buffer.size () < BENCH_CONSUME_SIZE ? buffer.size () : BENCH_CONSUME_SIZE;
+    ESEBuffer out       = subVector (buffer, 0, real_size);
+    buffer.erase (buffer.begin (), buffer.begin () + real_size);
+    if (!out.size ())
+      break;
+    total += out.size ();
+  }
+  return total;
+}
+
+static size_t
+bench_ese_reader (const ESEBuffer &stream, size_t read_length)
+{
+  ESEDataReader reader (MemoryReadFunc, const_cast<ESEBuffer *> (&stream));
+  size_t        total = 0;
+
+  reader.prepare ();
+  reader.setBufferReadLength (read_length);
+  while (true) {
+    ESEBuffer out = reader.getBuffer (BENCH_CONSUME_SIZE);
+    if (!out.size ())
+      break;
+    total += out.size ();
+  }
+  return total;
+}
+
+/// @brief Consumes a stream by small buffers with growing read lengths.
+static bool
+bench_reader ()
+{
+  ESEBuffer stream = make_stream (BENCH_STREAM_SIZE);
+  size_t    read_lengths[] = { 1024, 64 * 1024, 1024 * 1024 };
+
+  std::cout << "reader: consume " << BENCH_STREAM_SIZE << " bytes by " << BENCH_CONSUME_SIZE << std::endl;
+  for (size_t read_length : read_lengths) {
+    std::cout << " buffer read length " << read_length << std::endl;
+    BenchTimer vector_timer;
+    size_t     vector_total   = bench_vector_reader (stream, read_length);
+    double     vector_seconds = vector_timer.elapsed ();
+    report ("vector erase", vector_total, vector_seconds);
+
+    BenchTimer reader_timer;
+    size_t     reader_total   = bench_ese_reader (stream, read_length);
+    double     reader_seconds = reader_timer.elapsed ();
+    report ("ESEReader", reader_total, reader_seconds);
+
+    if (vector_total != stream.size () || reader_total != stream.size ()) {
+      std::cerr << "Error: consumed " << vector_total << " and " << reader_total << " bytes" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+#define LARGE_STREAM_FRAME_SIZE (1024 * 1024)
+#define LARGE_STREAM_FRAME_COUNT 2560
+
+struct LargeIVFStream {
+  uint64_t frameCount;
+  size_t   frameSize;
+  int64_t  maxOffset;
+};
+
+/// @brief Generates an IVF stream of frameCount frames of frameSize bytes on the fly.
+static size_t
+LargeIVFReadFunc (void *opaque, unsigned char *buffer, size_t size, int64_t offset)
+{
+  LargeIVFStream *stream     = static_cast<LargeIVFStream *> (opaque);
+  uint64_t        stride     = 12 + stream->frameSize;
+  uint64_t        total_size = sizeof (IVFHeader) + stream->frameCount * stride;
+  uint64_t        position   = static_cast<uint64_t> (offset);
+  size_t          read_size  = 0;
+
+  if (offset > stream->maxOffset)
+    stream->maxOffset = offset;
+  while (read_size < size && position < total_size) {
+    uint8_t byte;
+    if (position < sizeof (IVFHeader)) {
+      IVFHeader header;
+      std::memset (&header, 0, sizeof (header));
+      header.signature     = ESE_MAKE_FOURCC ('D', 'K', 'I', 'F');
+      header.length_header = sizeof (IVFHeader);
+      header.fourcc        = ESE_MAKE_FOURCC ('A', 'V', '0', '1');
+      header.frame_count   = static_cast<uint32_t> (stream->frameCount);
+      byte                 = reinterpret_cast<uint8_t *> (&header)[position];
+    } else {
+      uint64_t frame_offset = (position - sizeof (IVFHeader)) % stride;
+      uint64_t frame_index  = (position - sizeof (IVFHeader)) / stride;
+      if (frame_offset < 4)
+        byte = static_cast<uint8_t> (stream->frameSize >> (8 * frame_offset));
+      else if (frame_offset < 12)
+        byte = static_cast<uint8_t> (frame_index >> (8 * (frame_offset - 4)));
+      else {
+        // Fill the rest of the payload at once.
+        size_t span = static_cast<size_t> (stride - frame_offset);
+        if (span > size - read_size)
+          span = size - read_size;
+        std::memset (buffer + read_size, 0x55, span);
+        read_size += span;
+        position += span;
+        continue;
+      }
+    }
+    buffer[read_size++] = byte;
+    position++;
+  }
+  return read_size;
+}
+
+/// @brief Extracts a generated IVF stream larger than 2 GiB through the 64-bit read callback.
+static bool
+bench_large_stream ()
+{
+  LargeIVFStream stream     = { LARGE_STREAM_FRAME_COUNT, LARGE_STREAM_FRAME_SIZE, 0 };
+  uint64_t       total_size = sizeof (IVFHeader) + stream.frameCount * (12 + stream.frameSize);
+  ESEPacket     *pkt;
+
+  std::cout << "large: extract " << total_size << " bytes of IVF" << std::endl;
+  BenchTimer   timer;
+  ESExtractor *extractor = es_extractor_new_with_read_func64 (LargeIVFReadFunc, &stream, nullptr);
+  if (!extractor)
+    return false;
+  while (es_extractor_read_packet (extractor, &pkt) < ESE_RESULT_EOS)
+    es_extractor_clear_packet (pkt);
+  int packet_count = es_extractor_packet_count (extractor);
+  es_extractor_teardown (extractor);
+  report ("read_func64", total_size, timer.elapsed ());
+
+  if (packet_count != LARGE_STREAM_FRAME_COUNT || stream.maxOffset < (static_cast<int64_t> (1) << 31)) {
+    std::cerr << "Error: got " << packet_count << " packets up to offset " << stream.maxOffset << std::endl;
+    return false;
+  }
+  return true;
+}
+
+#define BORROW_STREAM_FRAME_COUNT 128
+
+static size_t
+MemoryReadFunc64 (void *opaque, unsigned char *buffer, size_t size, int64_t offset)
+{
+  const ESEBuffer *stream   = static_cast<const ESEBuffer *> (opaque);
+  size_t           position = static_cast<size_t> (offset);
+  if (position >= stream->size ())
+    return 0;
+  if (position + size > stream->size ())
+    size = stream->size () - position;
+  std::memcpy (buffer, stream->data () + position, size);
+  return size;
+}
+
+static size_t
+MemoryBorrowFunc (void *opaque, const unsigned char **buffer, size_t size, int64_t offset)
+{
+  const ESEBuffer *stream   = static_cast<const ESEBuffer *> (opaque);
+  size_t           position = static_cast<size_t> (offset);
+  (void)size;
+  if (position >= stream->size ())
+    return 0;
+  *buffer = stream->data () + position;
+  return stream->size () - position;
+}
+
+static int
+extract_all (ESExtractor *extractor)
+{
+  ESEPacket *pkt;
+
+  if (!extractor)
+    return -1;
+  while (es_extractor_read_packet (extractor, &pkt) < ESE_RESULT_EOS)
+    es_extractor_clear_packet (pkt);
+  int packet_count = es_extractor_packet_count (extractor);
+  es_extractor_teardown (extractor);
+  return packet_count;
+}
+
+#define BATCH_SIZE 64
+
+/// @brief Extracts the packets by batches of BATCH_SIZE.
+static int
+extract_all_batches (ESExtractor *extractor)
+{
+  ESEPacket *packets[BATCH_SIZE];
+  size_t     batch_size;
+
+  if (!extractor)
+    return -1;
+  while (es_extractor_read_packets (extractor, packets, BATCH_SIZE, &batch_size) < ESE_RESULT_EOS) {
+    for (size_t i = 0; i < batch_size; i++)
+      es_extractor_clear_packet (packets[i]);
+  }
+  int packet_count = es_extractor_packet_count (extractor);
+  es_extractor_teardown (extractor);
+  return packet_count;
+}
+
+/// @brief Extracts the packets to a single buffer, as a decoder input buffer
+/// grown when a packet does not fit.
+static int
+extract_all_into (ESExtractor *extractor, size_t capacity)
+{
+  ESEPacketInfo info;
+  ESEBuffer     data (capacity);
+  ESEResult     res;
+
+  if (!extractor)
+    return -1;
+  while ((res = es_extractor_read_packet_into (extractor, data.data (), data.size (), &info)) < ESE_RESULT_EOS
+    || res == ESE_RESULT_BUFFER_TOO_SMALL) {
+    if (res == ESE_RESULT_BUFFER_TOO_SMALL)
+      data.resize (info.data_size);
+  }
+  int packet_count = es_extractor_packet_count (extractor);
+  es_extractor_teardown (extractor);
+  return packet_count;
+}
+
+/// @brief Reads the packets as slices, summing their size as a gathering consumer would.
+static int
+extract_all_slices (ESExtractor *extractor, size_t *data_size)
+{
+  ESEPacketInfo   info;
+  const ESESlice *slices;
+  size_t          slice_count;
+
+  *data_size = 0;
+  if (!extractor)
+    return -1;
+  while (es_extractor_read_packet_slices (extractor, &slices, &slice_count, &info) < ESE_RESULT_EOS) {
+    for (size_t i = 0; i < slice_count; i++)
+      *data_size += slices[i].size;
+  }
+  int packet_count = es_extractor_packet_count (extractor);
+  es_extractor_teardown (extractor);
+  return packet_count;
+}
+
+/// @brief Extracts an IVF stream held in memory through the read and the borrow callbacks.
+static bool
+bench_borrow ()
+{
+  LargeIVFStream stream = { BORROW_STREAM_FRAME_COUNT, LARGE_STREAM_FRAME_SIZE, 0 };
+  ESEBuffer      data (sizeof (IVFHeader) + stream.frameCount * (12 + stream.frameSize));
+  data.resize (LargeIVFReadFunc (&stream, data.data (), data.size (), 0));
+
+  std::cout << "borrow: extract " << data.size () << " bytes of IVF from memory" << std::endl;
+  BenchTimer read_timer;
+  int        read_count = extract_all (es_extractor_new_with_read_func64 (MemoryReadFunc64, &data, nullptr));
+  report ("read_func64", data.size (), read_timer.elapsed ());
+
+  BenchTimer borrow_timer;
+  int        borrow_count = extract_all (es_extractor_new_with_borrow_func (MemoryBorrowFunc, nullptr, &data, nullptr));
+  report ("borrow_func", data.size (), borrow_timer.elapsed ());
+
+  if (read_count != BORROW_STREAM_FRAME_COUNT || borrow_count != BORROW_STREAM_FRAME_COUNT) {
+    std::cerr << "Error: got " << read_count << " and " << borrow_count << " packets" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+#define SCAN_STREAM_SIZE (256 * 1024 * 1024)
+#define SCAN_NAL_SIZE (64 * 1024)
+#define SCAN_ROUNDS 4
+
+/// @brief Generates NALs of random payload with emulation prevention bytes,
+/// so the only start codes are the ones at the NAL boundaries.
+static ESEBuffer
+make_nal_stream (size_t size, size_t nal_size, size_t *nal_count)
+{
+  ESEBuffer stream;
+  uint32_t  seed  = 1;
+  size_t    zeros = 0;
+
+  stream.reserve (size + size / 64);
+  *nal_count = 0;
+  while (stream.size () < size) {
+    if (stream.size () % nal_size < 3 && !zeros) {
+      stream.insert (stream.end (), { 0x00, 0x00, 0x01, 0x65 });
+      (*nal_count)++;
+      continue;
+    }
+    seed         = seed * 1103515245 + 12345;
+    uint8_t byte = static_cast<uint8_t> (seed >> 16);
+    // Bias towards zeros, as found in the residual data.
+    if ((seed >> 8 & 0x7) == 0)
+      byte = 0;
+    if (zeros >= 2 && byte <= 3) {
+      stream.push_back (0x03);
+      zeros = 0;
+    }
+    stream.push_back (byte);
+    zeros = byte ? 0 : zeros + 1;
+  }
+  return stream;
+}
+
+static size_t
+count_start_codes (ESEScanFunc scan, const ESEBuffer &stream)
+{
+  size_t count = 0, pos = 0;
+
+  while (pos < stream.size ()) {
+    size_t offset = scan (stream.data () + pos, stream.size () - pos);
+    if (offset == stream.size () - pos)
+      break;
+    pos += offset + 3;
+    count++;
+  }
+  return count;
+}
+
+/// @brief Checks that every kernel finds the same start code in short
+/// buffers made of 0, 1 and 2 bytes.
+static bool
+check_scan_kernels ()
+{
+  const std::vector<ESEScanKernel> &kernels = ese_scan_kernels ();
+  uint32_t                          seed    = 1;
+
+  for (size_t size = 0; size < 200; size++) {
+    for (int round = 0; round < 50; round++) {
+      ESEBuffer buffer (size);
+      for (uint8_t &byte : buffer) {
+        seed = seed * 1103515245 + 12345;
+        byte = static_cast<uint8_t> ((seed >> 16) % 3);
+      }
+      size_t expected = kernels.back ().scan (buffer.data (), buffer.size ());
+      for (const ESEScanKernel &kernel : kernels) {
+        if (kernel.scan (buffer.data (), buffer.size ()) != expected) {
+          std::cerr << "Error: " << kernel.name << " differs on a buffer of size " << size << std::endl;
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/// @brief Counts the start codes of a large stream with each scanning kernel.
+static bool
+bench_scan ()
+{
+  size_t    nal_count;
+  ESEBuffer stream = make_nal_stream (SCAN_STREAM_SIZE, SCAN_NAL_SIZE, &nal_count);
+
+  if (!check_scan_kernels ())
+    return false;
+  std::cout << "scan: " << nal_count << " start codes in " << stream.size () << " bytes" << std::endl;
+  for (const ESEScanKernel &kernel : ese_scan_kernels ()) {
+    size_t     count = 0;
+    BenchTimer timer;
+    for (int i = 0; i < SCAN_ROUNDS; i++)
+      count = count_start_codes (kernel.scan, stream);
+    double seconds = timer.elapsed ();
+    std::cout << "  " << kernel.name << ": " << (SCAN_ROUNDS * stream.size () / seconds) / (1024 * 1024 * 1024)
+              << " GB/s" << std::endl;
+    if (count != nal_count) {
+      std::cerr << "Error: " << kernel.name << " found " << count << " start codes" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+#define NAL_STREAM_SIZE (16 * 1024 * 1024)
+#define NAL_STREAM_NAL_SIZE 256
+
+/// @brief Extracts a stream made of many small NALs.
+static bool
+bench_nal ()
+{
+  size_t    nal_count;
+  ESEBuffer stream = make_nal_stream (NAL_STREAM_SIZE, NAL_STREAM_NAL_SIZE, &nal_count);
+  // Probe the stream as H.264 with an AUD first.
+  stream.insert (stream.begin (), { 0x00, 0x00, 0x00, 0x01, 0x09, 0x10 });
+
+  std::cout << "nal: extract " << nal_count + 1 << " NALs from " << stream.size () << " bytes" << std::endl;
+  BenchTimer timer;
+  int        packet_count = extract_all (es_extractor_new_with_borrow_func (MemoryBorrowFunc, nullptr, &stream, nullptr));
+  report ("alignment:NAL", stream.size (), timer.elapsed ());
+  BenchTimer batch_timer;
+  int        batch_count = extract_all_batches (es_extractor_new_with_borrow_func (MemoryBorrowFunc, nullptr, &stream, nullptr));
+  report ("read_packets", stream.size (), batch_timer.elapsed ());
+
+  if (packet_count != static_cast<int> (nal_count + 1) || batch_count != packet_count) {
+    std::cerr << "Error: got " << packet_count << " and " << batch_count << " packets" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+#define INTRA_FRAME_COUNT 2
+
+/// @brief Extracts streams of 10 to 50 MiB NALs with the default read length.
+/// The extraction is linear when the throughput does not drop with the NAL size.
+static bool
+bench_intra ()
+{
+  size_t frame_sizes[] = { 10 * 1024 * 1024, 25 * 1024 * 1024, 50 * 1024 * 1024 };
+
+  for (size_t frame_size : frame_sizes) {
+    size_t    nal_count;
+    ESEBuffer stream = make_nal_stream (INTRA_FRAME_COUNT * frame_size, frame_size, &nal_count);
+    stream.insert (stream.begin (), { 0x00, 0x00, 0x00, 0x01, 0x09, 0x10 });
+
+    std::cout << "intra: extract " << nal_count << " NALs of " << frame_size << " bytes" << std::endl;
+    BenchTimer timer;
+    int        packet_count = extract_all (es_extractor_new_with_read_func64 (MemoryReadFunc64, &stream, nullptr));
+    report ("read_func64", stream.size (), timer.elapsed ());
+
+    if (packet_count != static_cast<int> (nal_count + 1)) {
+      std::cerr << "Error: got " << packet_count << " packets" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+#define MAPPED_STREAM_SIZE (64 * 1024 * 1024)
+#define MAPPED_STREAM_NAL_SIZE (4 * 1024)
+#define MAPPED_STREAM_FILE "esebench-mapped.h264"
+#define SEEK_COUNT 1000
+
+/// @brief Extracts a mapped file with the packets copied or borrowed from the
+/// mapping, then written to the application buffer.
+static bool
+bench_mapped ()
+{
+  size_t      nal_count;
+  ESEBuffer   stream    = make_nal_stream (MAPPED_STREAM_SIZE, MAPPED_STREAM_NAL_SIZE, &nal_count);
+  const char *options[] = { nullptr, "packet-data:borrow" };
+  bool        ret       = true;
+
+  stream.insert (stream.begin (), { 0x00, 0x00, 0x00, 0x01, 0x09, 0x10 });
+  std::ofstream file (MAPPED_STREAM_FILE, std::ios::binary);
+  file.write (reinterpret_cast<const char *> (stream.data ()), static_cast<std::streamsize> (stream.size ()));
+  file.close ();
+
+  std::cout << "mapped: extract " << nal_count + 1 << " NALs from " << stream.size () << " bytes" << std::endl;
+  for (const char *option : options) {
+    BenchTimer timer;
+    int        packet_count = extract_all (es_extractor_new (MAPPED_STREAM_FILE, option));
+    report (option ? option : "packet-data:copy", stream.size (), timer.elapsed ());
+    if (packet_count != static_cast<int> (nal_count + 1)) {
+      std::cerr << "Error: got " << packet_count << " packets" << std::endl;
+      ret = false;
+    }
+  }
+  BenchTimer timer;
+  int        packet_count = extract_all_into (es_extractor_new (MAPPED_STREAM_FILE, nullptr), MAPPED_STREAM_NAL_SIZE);
+  report ("read_packet_into", stream.size (), timer.elapsed ());
+  if (packet_count != static_cast<int> (nal_count + 1)) {
+    std::cerr << "Error: got " << packet_count << " packets" << std::endl;
+    ret = false;
+  }
+  // Each slice NAL is an access unit, which gets an AUD.
+  BenchTimer au_timer;
+  int        au_count = extract_all (es_extractor_new (MAPPED_STREAM_FILE, "alignment:AU"));
+  report ("alignment:AU", stream.size (), au_timer.elapsed ());
+  size_t     data_size;
+  BenchTimer slices_timer;
+  int        slices_count = extract_all_slices (es_extractor_new (MAPPED_STREAM_FILE, "alignment:AU\npacket-data:borrow"), &data_size);
+  report ("read_packet_slices", stream.size (), slices_timer.elapsed ());
+  if (au_count != static_cast<int> (nal_count) || slices_count != au_count) {
+    std::cerr << "Error: got " << au_count << " and " << slices_count << " access units" << std::endl;
+    ret = false;
+  }
+  std::remove (MAPPED_STREAM_FILE);
+  return ret;
+}
+
+/// @brief Seeks to packets at the start and at the end of a mapped file,
+/// which costs the same once the file is indexed.
+static bool
+bench_seek ()
+{
+  size_t    nal_count;
+  ESEBuffer stream = make_nal_stream (MAPPED_STREAM_SIZE, MAPPED_STREAM_NAL_SIZE, &nal_count);
+  bool      ret    = true;
+
+  stream.insert (stream.begin (), { 0x00, 0x00, 0x00, 0x01, 0x09, 0x10 });
+  std::ofstream file (MAPPED_STREAM_FILE, std::ios::binary);
+  file.write (reinterpret_cast<const char *> (stream.data ()), static_cast<std::streamsize> (stream.size ()));
+  file.close ();
+
+  std::cout << "seek: seek in " << nal_count + 1 << " NALs of " << stream.size () << " bytes" << std::endl;
+  ESExtractor *extractor = es_extractor_new (MAPPED_STREAM_FILE, nullptr);
+  BenchTimer   timer;
+  ret &= es_extractor_build_index (extractor) == static_cast<int64_t> (nal_count + 1);
+  report ("build_index", stream.size (), timer.elapsed ());
+  const int64_t starts[] = { 0, static_cast<int64_t> (nal_count) - SEEK_COUNT };
+  for (int64_t start : starts) {
+    BenchTimer seek_timer;
+    for (int64_t i = 0; i < SEEK_COUNT; i++) {
+      ESEPacket *pkt;
+      ret &= es_extractor_seek_packet (extractor, start + i) && es_extractor_read_packet (extractor, &pkt) < ESE_RESULT_EOS;
+      if (ret)
+        es_extractor_clear_packet (pkt);
+    }
+    std::cout << "  seek_packet from " << start << ": " << seek_timer.elapsed () * 1e6 / SEEK_COUNT << " us" << std::endl;
+  }
+  if (!ret)
+    std::cerr << "Error: unable to seek" << std::endl;
+  es_extractor_teardown (extractor);
+  std::remove (MAPPED_STREAM_FILE);
+  return ret;
+}
+
+#define IVF_INDEX_FRAME_COUNT 4096
+#define IVF_INDEX_FRAME_SIZE (16 * 1024)
+#define IVF_INDEX_FILE "esebench-index.ivf"
+
+/// @brief Indexes an IVF file from its frame headers, then by reading its
+/// packets, with or without their payloads.
+static bool
+bench_ivf_index ()
+{
+  LargeIVFStream stream     = { IVF_INDEX_FRAME_COUNT, IVF_INDEX_FRAME_SIZE, 0 };
+  size_t         total_size = sizeof (IVFHeader) + IVF_INDEX_FRAME_COUNT * (12 + IVF_INDEX_FRAME_SIZE);
+  ESEBuffer      data (total_size);
+  bool           ret = true;
+
+  LargeIVFReadFunc (&stream, data.data (), total_size, 0);
+  std::ofstream file (IVF_INDEX_FILE, std::ios::binary);
+  file.write (reinterpret_cast<const char *> (data.data ()), static_cast<std::streamsize> (data.size ()));
+  file.close ();
+
+  std::cout << "ivfindex: index " << IVF_INDEX_FRAME_COUNT << " frames of " << total_size << " bytes" << std::endl;
+  const char *options[] = { nullptr, "reader:file" };
+  for (const char *option : options) {
+    ESExtractor *extractor = es_extractor_new (IVF_INDEX_FILE, option);
+    BenchTimer   timer;
+    ret &= es_extractor_build_index (extractor) == IVF_INDEX_FRAME_COUNT;
+    double seconds = timer.elapsed ();
+    report (std::string ("build_index ") + (option ? option : "reader:mmap"), total_size, seconds);
+    std::cout << "    " << seconds * 1e6 / IVF_INDEX_FRAME_COUNT << " us per frame" << std::endl;
+    es_extractor_teardown (extractor);
+  }
+  BenchTimer timer;
+  ret &= extract_all (es_extractor_new (IVF_INDEX_FILE, nullptr)) == IVF_INDEX_FRAME_COUNT;
+  report ("read_packet", total_size, timer.elapsed ());
+  // The frames are skipped after their first bytes.
+  for (const char *option : options) {
+    std::string          none_options = std::string (option ? option : "") + "\npacket-data:none";
+    ESExtractor         *extractor    = es_extractor_new (IVF_INDEX_FILE, none_options.c_str ());
+    ESEPacketDescriptor desc;
+    int                  packet_count = 0;
+    BenchTimer           desc_timer;
+    while (es_extractor_read_packet_descriptor (extractor, &desc) < ESE_RESULT_EOS)
+      packet_count++;
+    report (std::string ("read_packet_descriptor ") + (option ? option : "reader:mmap"), total_size, desc_timer.elapsed ());
+    ret &= packet_count == IVF_INDEX_FRAME_COUNT;
+    es_extractor_teardown (extractor);
+  }
+  if (!ret)
+    std::cerr << "Error: unable to index the IVF file" << std::endl;
+  std::remove (IVF_INDEX_FILE);
+  return ret;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string bench = argc > 1 ? argv[1] : "";
+  bool        ret   = true;
+
+  if (bench.empty () || bench == "reader")
+    ret &= bench_reader ();
+  if (bench.empty () || bench == "large")
+    ret &= bench_large_stream ();
+  if (bench.empty () || bench == "borrow")
+    ret &= bench_borrow ();
+  if (bench.empty () || bench == "scan")
+    ret &= bench_scan ();
+  if (bench.empty () || bench == "nal")
+    ret &= bench_nal ();
+  if (bench.empty () || bench == "intra")
+    ret &= bench_intra ();
+  if (bench.empty () || bench == "mapped")
+    ret &= bench_mapped ();
+  if (bench.empty () || bench == "seek")
+    ret &= bench_seek ();
+  if (bench.empty () || bench == "ivfindex")
+    ret &= bench_ivf_index ();
+
+  return ret ? 0 : 1;
+}
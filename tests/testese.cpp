@@ -16,15 +16,47 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
+#include <iterator>
+#include <map>
+#include <new>
+#include <set>
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#endif
 
+#include "esebitreader.h"
 #include "esefilereader.h"
+#include "eseivfstream.h"
 #include "eselogger.h"
 #include "eseutils.h"
 #include "esextractor.h"
 #include "testese.h"
 
+// Counts the heap allocations made through operator new, by the test and the
+// library when it uses the replaced operator, see library_allocations_counted.
+static std::atomic<int> s_allocationCount (0);
+
+void *
+operator new (size_t size)
+{
+  s_allocationCount++;
+  void *data = std::malloc (size ? size : 1);
+  if (!data)
+    throw std::bad_alloc ();
+  return data;
+}
+
+void
+operator delete (void *data) noexcept
+{
+  std::free (data);
+}
+
 static void
 dump_packet (ESExtractor *esextractor, ESEPacket *pkt)
 {
@@ -67,6 +99,8 @@ parse (ESExtractor *esextractor)
 
   packet_count = es_extractor_packet_count (esextractor);
   INFO ("Got %d packet(s)", packet_count);
+  if (es_extractor_packet_count64 (esextractor) != packet_count)
+    return -1;
   return packet_count;
 }
 
@@ -93,13 +127,13 @@ class DataProvider {
     }
   }
 
-  size_t getData (uint8_t *out_buffer, size_t data_size, int32_t offset)
+  size_t getData (uint8_t *out_buffer, size_t data_size, int64_t offset)
   {
     ESEBuffer buffer;
     size_t    read_size;
 
     m_file.clear ();
-    m_file.seekg (offset, m_file.beg);
+    m_file.seekg (static_cast<std::streamoff> (offset), m_file.beg);
     buffer.resize (data_size);
     m_file.read (reinterpret_cast<char *> (buffer.data ()), data_size);
     read_size = static_cast<size_t> (m_file.gcount ());
@@ -120,6 +154,14 @@ ReadBufferFunc (void *opaque, unsigned char *pBuf, size_t size, int32_t offset)
   return read_size;
 }
 
+static size_t
+ReadBufferFunc64 (void *opaque, unsigned char *pBuf, size_t size, int64_t offset)
+{
+  size_t read_size = (static_cast<DataProvider *> (opaque))->getData (pBuf, size, offset);
+  DBG ("ReadBuf read_size=%zd size=%zd offset=%" PRId64, read_size, size, offset);
+  return read_size;
+}
+
 int
 parse_data (const char *fileName, const char *options, uint8_t debug_level)
 {
@@ -137,3 +179,1192 @@ parse_data (const char *fileName, const char *options, uint8_t debug_level)
 
   return packet_count;
 }
+
+int
+parse_data64 (const char *fileName, const char *options, uint8_t debug_level)
+{
+  es_extractor_set_log_level (debug_level);
+  INFO ("Extracting packets from %s with options %s", fileName, options);
+  std::unique_ptr<DataProvider> pDataProvider = make_unique<DataProvider> (fileName);
+
+  ESExtractor *esextractor = es_extractor_new_with_read_func64 (&ReadBufferFunc64, pDataProvider.get (), options);
+  if (!esextractor) {
+    ERR ("Unable to discover a compatible stream. Exit");
+    return -1;
+  }
+  int packet_count = parse (esextractor);
+  es_extractor_teardown (esextractor);
+
+  return packet_count;
+}
+
+/// @brief Lends a file loaded in memory by blocks of blockSize bytes.
+struct BorrowProvider {
+  ESEBuffer data;
+  size_t    blockSize;
+  int       borrowed;
+};
+
+static size_t
+BorrowBufferFunc (void *opaque, const unsigned char **buffer, size_t size, int64_t offset)
+{
+  BorrowProvider *provider = static_cast<BorrowProvider *> (opaque);
+  size_t          position = static_cast<size_t> (offset);
+  (void)size;
+
+  if (position >= provider->data.size ())
+    return 0;
+  // Lend up to the end of the block holding the offset.
+  size_t block_end = (position / provider->blockSize + 1) * provider->blockSize;
+  if (block_end > provider->data.size ())
+    block_end = provider->data.size ();
+  *buffer = provider->data.data () + position;
+  provider->borrowed++;
+  return block_end - position;
+}
+
+static void
+ReleaseBufferFunc (void *opaque, const unsigned char *buffer)
+{
+  (void)buffer;
+  static_cast<BorrowProvider *> (opaque)->borrowed--;
+}
+
+/// @brief Returns the packet count, or -1 if a borrowed block has not been released.
+int
+parse_borrow (const char *fileName, const char *options, size_t block_size, uint8_t debug_level)
+{
+  es_extractor_set_log_level (debug_level);
+  INFO ("Borrowing %s by %zd bytes with options %s", fileName, block_size, options);
+  std::ifstream  file (fileName, std::ios::binary);
+  BorrowProvider provider;
+  provider.data.assign (std::istreambuf_iterator<char> (file), std::istreambuf_iterator<char> ());
+  provider.blockSize = block_size;
+  provider.borrowed  = 0;
+
+  ESExtractor *esextractor = es_extractor_new_with_borrow_func (&BorrowBufferFunc, &ReleaseBufferFunc, &provider, options);
+  if (!esextractor) {
+    ERR ("Unable to discover a compatible stream. Exit");
+    return -1;
+  }
+  int packet_count = parse (esextractor);
+  es_extractor_teardown (esextractor);
+  if (provider.borrowed) {
+    ERR ("%d borrowed buffers have not been released", provider.borrowed);
+    return -1;
+  }
+  return packet_count;
+}
+
+/// @brief Pushes the file by chunks of chunk_size bytes and reads the packets
+/// available after each chunk.
+int
+parse_push (const char *fileName, const char *options, size_t chunk_size, uint8_t debug_level)
+{
+  ESEResult  res;
+  ESEPacket *pkt;
+
+  es_extractor_set_log_level (debug_level);
+  INFO ("Pushing %s by %zd bytes with options %s", fileName, chunk_size, options);
+  DataProvider provider (fileName);
+  ESExtractor *esextractor = es_extractor_new_push (options);
+  if (!esextractor) {
+    ERR ("Unable to create a push extractor. Exit");
+    return -1;
+  }
+
+  ESEBuffer chunk (chunk_size);
+  int64_t   offset = 0;
+  size_t    read_size;
+  do {
+    read_size = provider.getData (chunk.data (), chunk_size, offset);
+    offset += static_cast<int64_t> (read_size);
+    if (read_size)
+      es_extractor_push_data (esextractor, chunk.data (), read_size);
+    else
+      es_extractor_push_eos (esextractor);
+    while ((res = es_extractor_read_packet (esextractor, &pkt)) < ESE_RESULT_EOS) {
+      dump_packet (esextractor, pkt);
+      es_extractor_clear_packet (pkt);
+    }
+  } while (read_size && res == ESE_RESULT_NO_PACKET);
+
+  int packet_count = es_extractor_packet_count (esextractor);
+  INFO ("Got %d packet(s)", packet_count);
+  es_extractor_teardown (esextractor);
+  if (res != ESE_RESULT_EOS)
+    return -1;
+  return packet_count;
+}
+
+/// @brief Pushes the stream of fileName repeated repeat times, then sets
+/// options once read_count packets have been read.
+/// @return the packet count, or -1 if the stream is not read to its end.
+int
+parse_push_options (const char *fileName, int repeat, int read_count, const char *options, uint8_t debug_level)
+{
+  ESEResult  res;
+  ESEPacket *pkt;
+  int        packet_count = 0;
+
+  es_extractor_set_log_level (debug_level);
+  DataProvider provider (fileName);
+  ESExtractor *esextractor = es_extractor_new_push (nullptr);
+  if (!esextractor)
+    return -1;
+  ESEBuffer chunk (4096);
+  for (int i = 0; i < repeat; i++) {
+    int64_t offset = 0;
+    size_t  read_size;
+    while ((read_size = provider.getData (chunk.data (), chunk.size (), offset))) {
+      es_extractor_push_data (esextractor, chunk.data (), read_size);
+      offset += static_cast<int64_t> (read_size);
+    }
+  }
+  es_extractor_push_eos (esextractor);
+  while ((res = es_extractor_read_packet (esextractor, &pkt)) < ESE_RESULT_EOS) {
+    es_extractor_clear_packet (pkt);
+    if (++packet_count == read_count)
+      es_extractor_set_options (esextractor, options);
+  }
+  INFO ("Got %d packet(s), setting %s after %d", packet_count, options, read_count);
+  es_extractor_teardown (esextractor);
+  return res == ESE_RESULT_EOS ? packet_count : -1;
+}
+
+/// @brief Returns whether the allocations of the library are counted. The
+/// replaced operator new is not used by a library which has its own, such as
+/// a Windows DLL, where count_allocations would only count the test ones.
+bool
+library_allocations_counted ()
+{
+  int          allocations = s_allocationCount;
+  ESExtractor *esextractor = es_extractor_new_push (nullptr);
+  if (!esextractor)
+    return false;
+  allocations = s_allocationCount - allocations;
+  es_extractor_teardown (esextractor);
+  if (!allocations)
+    INFO ("The allocations of the library are not counted");
+  return allocations > 0;
+}
+
+/// @brief Extracts the stream of fileName repeated repeat times, the first
+/// skip bytes of the file being only kept once.
+/// @param warmup number of packets extracted before counting the allocations
+/// @param into read the packets with es_extractor_read_packet_into
+/// @param packet_count set to the number of packets extracted after the warmup
+/// @return the heap allocations made after the warmup, or -1 on error.
+int
+count_allocations (const char *fileName, const char *options, size_t skip, int repeat, int warmup, bool into, int *packet_count)
+{
+  ESEResult     res;
+  ESEPacket    *pkt;
+  ESEPacketInfo info;
+  ESEBuffer     packet_data (1024 * 1024);
+  int           count = 0;
+  int           allocations;
+
+  std::ifstream  file (fileName, std::ios::binary);
+  ESEBuffer      data ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char> ());
+  BorrowProvider provider;
+  provider.data = data;
+  for (int i = 1; i < repeat; i++)
+    provider.data.insert (provider.data.end (), data.begin () + skip, data.end ());
+  provider.blockSize = provider.data.size ();
+  provider.borrowed  = 0;
+
+  ESExtractor *esextractor = es_extractor_new_with_borrow_func (&BorrowBufferFunc, &ReleaseBufferFunc, &provider, options);
+  if (!esextractor) {
+    ERR ("Unable to discover a compatible stream. Exit");
+    return -1;
+  }
+  allocations = s_allocationCount;
+  while (true) {
+    if (into) {
+      res = es_extractor_read_packet_into (esextractor, packet_data.data (), packet_data.size (), &info);
+    } else if ((res = es_extractor_read_packet (esextractor, &pkt)) < ESE_RESULT_EOS) {
+      es_extractor_clear_packet (pkt);
+    }
+    if (res >= ESE_RESULT_EOS)
+      break;
+    if (++count == warmup)
+      allocations = s_allocationCount;
+  }
+  allocations   = s_allocationCount - allocations;
+  *packet_count = count - warmup;
+  INFO ("Got %d allocation(s) for %d packet(s) after %d packet(s)", allocations, *packet_count, warmup);
+  es_extractor_teardown (esextractor);
+  return count > warmup ? allocations : -1;
+}
+
+/// @brief Returns the NAL of a packet, after its start code.
+static ESEBuffer
+packet_payload (const ESEPacket *pkt)
+{
+  size_t start = 0;
+  while (start < pkt->data_size && !pkt->data[start])
+    start++;
+  return ESEBuffer (pkt->data + start + 1, pkt->data + pkt->data_size);
+}
+
+/// @brief Compares the packets borrowed from the file mapping to the copied
+/// ones. The borrowed packets are released after the extractor teardown.
+/// @return the packet count, or -1 if a packet differs.
+int
+parse_borrowed_packets (const char *fileName, uint8_t debug_level)
+{
+  ESEResult               res;
+  ESEPacket              *pkt;
+  std::vector<ESEBuffer>  copied;
+  std::vector<ESEPacket *> borrowed;
+  int                     packet_count = 0;
+
+  ESExtractor *esextractor = create_es_extractor (fileName, nullptr, debug_level);
+  if (!esextractor)
+    return -1;
+  while ((res = es_extractor_read_packet (esextractor, &pkt)) < ESE_RESULT_EOS) {
+    copied.push_back (packet_payload (pkt));
+    es_extractor_clear_packet (pkt);
+  }
+  es_extractor_teardown (esextractor);
+
+  esextractor = create_es_extractor (fileName, "packet-data:borrow", debug_level);
+  if (!esextractor)
+    return -1;
+  while ((res = es_extractor_read_packet (esextractor, &pkt)) < ESE_RESULT_EOS)
+    borrowed.push_back (pkt);
+  es_extractor_teardown (esextractor);
+
+  for (size_t i = 0; i < borrowed.size (); i++) {
+    if (i < copied.size () && packet_payload (borrowed[i]) == copied[i])
+      packet_count++;
+    else
+      ERR ("The borrowed packet %zd differs", i);
+    es_extractor_clear_packet (borrowed[i]);
+  }
+  INFO ("Got %d identical packet(s)", packet_count);
+  if (packet_count != static_cast<int> (copied.size ()) || borrowed.size () != copied.size ())
+    return -1;
+  return packet_count;
+}
+
+/// @brief Reads the packets to a buffer of capacity bytes, grown when too
+/// small, and compares them to the packets of es_extractor_read_packet.
+/// @return the packet count, or -1 if a packet differs.
+int
+parse_into (const char *fileName, const char *options, size_t capacity, uint8_t debug_level)
+{
+  ESEResult     res;
+  ESEPacket    *pkt;
+  ESEPacketInfo info;
+  ESEBuffer     data (capacity);
+  int           packet_count = 0;
+  int           too_small    = 0;
+
+  ESExtractor *reference   = create_es_extractor (fileName, options, debug_level);
+  ESExtractor *esextractor = create_es_extractor (fileName, options, debug_level);
+  if (!reference || !esextractor)
+    return -1;
+  while ((res = es_extractor_read_packet (reference, &pkt)) < ESE_RESULT_EOS) {
+    while ((res = es_extractor_read_packet_into (esextractor, data.data (), data.size (), &info)) == ESE_RESULT_BUFFER_TOO_SMALL) {
+      data.resize (info.data_size);
+      too_small++;
+    }
+    if (res >= ESE_RESULT_EOS || info.data_size != pkt->data_size || info.pts != pkt->pts
+      || info.packet_number != static_cast<uint64_t> (pkt->packet_number)
+      || !std::equal (pkt->data, pkt->data + pkt->data_size, data.begin ())) {
+      ERR ("The packet %d differs", packet_count);
+      packet_count = -1;
+      es_extractor_clear_packet (pkt);
+      break;
+    }
+    packet_count++;
+    es_extractor_clear_packet (pkt);
+  }
+  if (packet_count >= 0 && es_extractor_read_packet_into (esextractor, data.data (), data.size (), &info) != ESE_RESULT_EOS)
+    packet_count = -1;
+  INFO ("Got %d packet(s), the buffer was grown %d time(s)", packet_count, too_small);
+  es_extractor_teardown (reference);
+  es_extractor_teardown (esextractor);
+  return packet_count;
+}
+
+/// @brief Gathers the slices of the packets and compares them to the packets
+/// of es_extractor_read_packet.
+/// @param slice_total set to the number of slices read
+/// @return the packet count, or -1 if a packet differs.
+int
+parse_slices (const char *fileName, const char *options, size_t *slice_total, uint8_t debug_level)
+{
+  ESEResult       res;
+  ESEPacket      *pkt;
+  ESEPacketInfo   info;
+  const ESESlice *slices;
+  size_t          slice_count;
+  ESEBuffer       data;
+  int             packet_count = 0;
+
+  *slice_total             = 0;
+  ESExtractor *reference   = create_es_extractor (fileName, options, debug_level);
+  ESExtractor *esextractor = create_es_extractor (fileName, options, debug_level);
+  if (!reference || !esextractor)
+    return -1;
+  while ((res = es_extractor_read_packet (reference, &pkt)) < ESE_RESULT_EOS) {
+    res = es_extractor_read_packet_slices (esextractor, &slices, &slice_count, &info);
+    data.clear ();
+    for (size_t i = 0; i < slice_count; i++)
+      data.insert (data.end (), slices[i].data, slices[i].data + slices[i].size);
+    *slice_total += slice_count;
+    bool same = res < ESE_RESULT_EOS && info.data_size == pkt->data_size && data.size () == pkt->data_size
+      && info.packet_number == static_cast<uint64_t> (pkt->packet_number)
+      && std::equal (data.begin (), data.end (), pkt->data);
+    es_extractor_clear_packet (pkt);
+    if (!same) {
+      ERR ("The packet %d differs", packet_count);
+      packet_count = -1;
+      break;
+    }
+    packet_count++;
+  }
+  if (packet_count >= 0 && es_extractor_read_packet_slices (esextractor, &slices, &slice_count, &info) != ESE_RESULT_EOS)
+    packet_count = -1;
+  INFO ("Got %d packet(s) in %zd slice(s)", packet_count, *slice_total);
+  es_extractor_teardown (reference);
+  es_extractor_teardown (esextractor);
+  return packet_count;
+}
+
+/// @brief Reads the packets by batches of max and compares them to the packets
+/// of es_extractor_read_packet.
+/// @return the packet count, or -1 if a packet or a batch differs.
+int
+parse_batches (const char *fileName, const char *options, size_t max, uint8_t debug_level)
+{
+  ESEResult               res;
+  ESEPacket              *pkt;
+  std::vector<ESEPacket *> packets (max);
+  size_t                  batch_size;
+  int                     packet_count = 0;
+  bool                    same         = true;
+
+  ESExtractor *reference   = create_es_extractor (fileName, options, debug_level);
+  ESExtractor *esextractor = create_es_extractor (fileName, options, debug_level);
+  if (!reference || !esextractor)
+    return -1;
+  while (same && (res = es_extractor_read_packets (esextractor, packets.data (), max, &batch_size)) < ESE_RESULT_EOS) {
+    // Only the last batch of the stream can be shorter.
+    same = batch_size > 0 && (batch_size == max || res == ESE_RESULT_LAST_PACKET);
+    for (size_t i = 0; i < batch_size; i++) {
+      same &= es_extractor_read_packet (reference, &pkt) < ESE_RESULT_EOS && pkt->data_size == packets[i]->data_size
+        && pkt->pts == packets[i]->pts && std::equal (pkt->data, pkt->data + pkt->data_size, packets[i]->data);
+      es_extractor_clear_packet (pkt);
+      es_extractor_clear_packet (packets[i]);
+    }
+    packet_count += static_cast<int> (batch_size);
+  }
+  if (!same || res != ESE_RESULT_EOS || batch_size || es_extractor_read_packet (reference, &pkt) != ESE_RESULT_EOS) {
+    ERR ("The batch ending at packet %d differs", packet_count);
+    packet_count = -1;
+  }
+  INFO ("Got %d packet(s) by batches of %zd", packet_count, max);
+  es_extractor_teardown (reference);
+  es_extractor_teardown (esextractor);
+  return packet_count;
+}
+
+struct TestAllocator {
+  std::map<uint8_t *, size_t> blocks;
+  int                         allocations;
+  int                         fail_at;
+};
+
+static void *
+TestAllocFunc (void *opaque, size_t size)
+{
+  TestAllocator *allocator = static_cast<TestAllocator *> (opaque);
+  if (allocator->allocations++ == allocator->fail_at)
+    return nullptr;
+  uint8_t *block            = static_cast<uint8_t *> (std::malloc (size));
+  allocator->blocks[block] = size;
+  return block;
+}
+
+static void
+TestFreeFunc (void *opaque, void *data)
+{
+  TestAllocator *allocator = static_cast<TestAllocator *> (opaque);
+  assert (allocator->blocks.erase (static_cast<uint8_t *> (data)) == 1);
+  std::free (data);
+}
+
+/// @brief Extracts the packets with an application allocator, checking that
+/// each payload lies in a block of the allocator.
+/// @param fail_at index of the allocation to fail, or -1
+/// @return the packet count, or -1 if a payload is not in a block of the
+/// allocator or if a block is not freed.
+int
+parse_with_allocator (const char *fileName, const char *options, int fail_at, uint8_t debug_level)
+{
+  ESEResult     res;
+  ESEPacket    *pkt;
+  TestAllocator allocator;
+  int           packet_count = 0;
+  int           error_count  = 0;
+  bool          inside       = true;
+
+  allocator.allocations    = 0;
+  allocator.fail_at        = fail_at;
+  ESExtractor *esextractor = create_es_extractor (fileName, options, debug_level);
+  if (!esextractor)
+    return -1;
+  es_extractor_set_allocator (esextractor, TestAllocFunc, TestFreeFunc, &allocator);
+  // Keep a packet across the teardown, it is freed by the allocator.
+  ESEPacket *kept = nullptr;
+  while ((res = es_extractor_read_packet (esextractor, &pkt)) < ESE_RESULT_EOS || res == ESE_RESULT_ERROR) {
+    if (res == ESE_RESULT_ERROR) {
+      // The packet is returned by the next read.
+      if (error_count++)
+        break;
+      continue;
+    }
+    auto block = allocator.blocks.upper_bound (pkt->data);
+    if (block == allocator.blocks.begin ()) {
+      inside = false;
+    } else {
+      --block;
+      inside &= pkt->data + pkt->data_size <= block->first + block->second;
+    }
+    if (!kept)
+      kept = pkt;
+    else
+      es_extractor_clear_packet (pkt);
+    packet_count++;
+  }
+  if (res != ESE_RESULT_EOS || error_count != (fail_at >= 0) || !inside)
+    packet_count = -1;
+  INFO ("Got %d packet(s) in %d allocation(s)", packet_count, allocator.allocations);
+  es_extractor_teardown (esextractor);
+  if (kept)
+    es_extractor_clear_packet (kept);
+  if (!allocator.blocks.empty ()) {
+    ERR ("%zd block(s) are not freed", allocator.blocks.size ());
+    return -1;
+  }
+  return packet_count;
+}
+
+/// @brief Compares the packets to the file data located by their descriptor,
+/// which ends the packets as the added AUD is not part of the file, and
+/// checks that the index is complete once the packets are read.
+/// @return the packet count, or -1 if a packet is not found in the file.
+int
+parse_index (const char *fileName, const char *options, int *keyframe_count, uint8_t debug_level)
+{
+  ESEResult           res;
+  ESEPacket          *pkt;
+  ESEPacketDescriptor desc;
+  int                 packet_count = 0;
+  bool                found        = true;
+
+  std::ifstream file (fileName, std::ios::binary);
+  ESEBuffer     data ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char> ());
+
+  *keyframe_count          = 0;
+  ESExtractor *esextractor = create_es_extractor (fileName, options, debug_level);
+  if (!esextractor)
+    return -1;
+  while (found && (res = es_extractor_read_packet (esextractor, &pkt)) < ESE_RESULT_EOS) {
+    found = es_extractor_packet_descriptor (esextractor, packet_count, &desc) && desc.pts == pkt->pts
+      && desc.size <= pkt->data_size && desc.offset + desc.size <= data.size ()
+      && std::equal (data.begin () + desc.offset, data.begin () + desc.offset + desc.size, pkt->data + pkt->data_size - desc.size);
+    if (desc.flags & ESE_PACKET_FLAG_KEYFRAME)
+      (*keyframe_count)++;
+    es_extractor_clear_packet (pkt);
+    packet_count++;
+  }
+  // The index is complete, the stream is not parsed again.
+  if (!found || es_extractor_build_index (esextractor) != packet_count) {
+    ERR ("The packet %d is not found in the file", packet_count - 1);
+    packet_count = -1;
+  }
+  INFO ("Got %d packet(s) with %d key frame(s)", packet_count, *keyframe_count);
+  es_extractor_teardown (esextractor);
+  return packet_count;
+}
+
+/// @brief Builds and saves the index, then compares it to the one loaded by
+/// another extractor, and reads the packets from the first one.
+/// @return the packet count, or -1 if the indexes differ.
+int
+save_index (const char *fileName, const char *options, const char *indexName, uint8_t debug_level)
+{
+  ESEPacketDescriptor desc, loaded;
+  std::string         indexOptions = std::string (options ? options : "") + "\nindex:" + indexName;
+  bool                same         = true;
+
+  ESExtractor *esextractor = create_es_extractor (fileName, options, debug_level);
+  if (!esextractor)
+    return -1;
+  int64_t packet_count = es_extractor_build_index (esextractor);
+  if (packet_count <= 0 || !es_extractor_save_index (esextractor, indexName)) {
+    es_extractor_teardown (esextractor);
+    return -1;
+  }
+  ESExtractor *other = create_es_extractor (fileName, indexOptions.c_str (), debug_level);
+  for (int64_t i = 0; other && same && i < packet_count; i++) {
+    same = es_extractor_packet_descriptor (esextractor, i, &desc) && es_extractor_packet_descriptor (other, i, &loaded)
+      && !memcmp (&desc, &loaded, sizeof (desc));
+  }
+  same &= other && es_extractor_build_index (other) == packet_count;
+  // The index is built from the start of the stream.
+  same &= parse (esextractor) == packet_count;
+  if (!same) {
+    ERR ("The index loaded from %s differs", indexName);
+    packet_count = -1;
+  }
+  INFO ("Saved the index of %" PRId64 " packet(s) to %s", packet_count, indexName);
+  if (other)
+    es_extractor_teardown (other);
+  es_extractor_teardown (esextractor);
+  return static_cast<int> (packet_count);
+}
+
+/// @brief Copies fileName to copyName with the modification time seconds and
+/// nanoseconds, as a file rewritten within the same second.
+/// @return false if the copy fails or the time can not be set.
+bool
+copy_file_with_time (const char *fileName, const char *copyName, int64_t seconds, long nanoseconds)
+{
+  std::ifstream in (fileName, std::ios::binary);
+  {
+    std::ofstream out (copyName, std::ios::binary);
+    out << in.rdbuf ();
+    if (!out.good ())
+      return false;
+  }
+#ifdef _WIN32
+  (void)seconds;
+  (void)nanoseconds;
+  return false;
+#else
+  struct timespec times[2];
+  times[0].tv_sec  = static_cast<time_t> (seconds);
+  times[0].tv_nsec = nanoseconds;
+  times[1]         = times[0];
+  return !utimensat (AT_FDCWD, copyName, times, 0);
+#endif
+}
+
+/// @brief Adds added to the packet count of the index file indexName, whose
+/// header ends with the 64-bit count.
+bool
+corrupt_index_count (const char *indexName, uint64_t added)
+{
+  std::fstream file (indexName, std::ios::binary | std::ios::in | std::ios::out);
+  uint64_t     count;
+  // magic, version, byte order, entry size, stream size, modification time,
+  // format, codec, alignment and reserved fields.
+  const std::streamoff count_offset = 48;
+
+  file.seekg (count_offset);
+  if (!file.read (reinterpret_cast<char *> (&count), sizeof (count)))
+    return false;
+  count += added;
+  file.seekp (count_offset);
+  file.write (reinterpret_cast<const char *> (&count), sizeof (count));
+  return file.good ();
+}
+
+/// @brief Returns the number of packets indexed once the stream is open.
+int
+indexed_packets (const char *fileName, const char *options, uint8_t debug_level)
+{
+  ESEPacketDescriptor desc;
+  int                 packet_count = 0;
+
+  ESExtractor *esextractor = create_es_extractor (fileName, options, debug_level);
+  if (!esextractor)
+    return -1;
+  while (es_extractor_packet_descriptor (esextractor, packet_count, &desc))
+    packet_count++;
+  es_extractor_teardown (esextractor);
+  return packet_count;
+}
+
+/// @brief Seeks to the packets in a shuffled order, from a stream without
+/// index, and compares them to the packets read in order.
+/// @return the packet count, or -1 if a packet differs.
+int
+parse_seek (const char *fileName, const char *options, uint8_t debug_level)
+{
+  ESEResult              res;
+  ESEPacket             *pkt;
+  std::vector<ESEBuffer> packets;
+  bool                   same = true;
+
+  ESExtractor *reference = create_es_extractor (fileName, options, debug_level);
+  if (!reference)
+    return -1;
+  while ((res = es_extractor_read_packet (reference, &pkt)) < ESE_RESULT_EOS) {
+    packets.push_back (ESEBuffer (pkt->data, pkt->data + pkt->data_size));
+    es_extractor_clear_packet (pkt);
+  }
+  es_extractor_teardown (reference);
+
+  ESExtractor *esextractor = create_es_extractor (fileName, options, debug_level);
+  if (!esextractor)
+    return -1;
+  int packet_count = static_cast<int> (packets.size ());
+  // Start from the middle of the stream, then alternate both ends.
+  std::vector<int> order;
+  order.push_back (packet_count / 2);
+  for (int i = 0; i < packet_count; i++)
+    order.push_back (i % 2 ? i / 2 : packet_count - 1 - i / 2);
+  for (int number : order) {
+    same &= es_extractor_seek_packet (esextractor, number) && es_extractor_read_packet (esextractor, &pkt) < ESE_RESULT_EOS;
+    if (!same) {
+      ERR ("Unable to seek to the packet %d", number);
+      break;
+    }
+    same &= ESEBuffer (pkt->data, pkt->data + pkt->data_size) == packets[static_cast<size_t> (number)];
+    es_extractor_clear_packet (pkt);
+  }
+  // A missing packet does not move the stream, which is read to its end.
+  int number = packet_count / 3;
+  same &= es_extractor_seek_packet (esextractor, number) && !es_extractor_seek_packet (esextractor, packet_count)
+    && !es_extractor_seek_packet (esextractor, -1);
+  while (same && (res = es_extractor_read_packet (esextractor, &pkt)) < ESE_RESULT_EOS) {
+    same &= number < packet_count && ESEBuffer (pkt->data, pkt->data + pkt->data_size) == packets[static_cast<size_t> (number++)];
+    es_extractor_clear_packet (pkt);
+  }
+  if (!same || number != packet_count) {
+    ERR ("The packet %d differs once seeking", number);
+    packet_count = -1;
+  }
+  INFO ("Got %d packet(s) by seeking", packet_count);
+  es_extractor_teardown (esextractor);
+  return packet_count;
+}
+
+/// @brief Seeks to the time of each packet, to the packet or to its key frame.
+/// @return the number of key frames found, or -1 if a seek fails.
+int
+parse_seek_time (const char *fileName, const char *options, uint8_t debug_level)
+{
+  ESEResult             res;
+  ESEPacket            *pkt;
+  std::vector<uint64_t> times;
+  std::vector<bool>     keyframes;
+  ESEPacketDescriptor   desc;
+  std::set<uint64_t>    found;
+  bool                  same = true;
+
+  ESExtractor *esextractor = create_es_extractor (fileName, options, debug_level);
+  if (!esextractor)
+    return -1;
+  while ((res = es_extractor_read_packet (esextractor, &pkt)) < ESE_RESULT_EOS) {
+    es_extractor_packet_descriptor (esextractor, static_cast<int64_t> (times.size ()), &desc);
+    times.push_back (pkt->pts);
+    keyframes.push_back (desc.flags & ESE_PACKET_FLAG_KEYFRAME);
+    es_extractor_clear_packet (pkt);
+  }
+  for (size_t i = times.size (); same && i-- > 0;) {
+    same = es_extractor_seek_time (esextractor, times[i], ESE_SEEK_FLAG_ANY) && es_extractor_read_packet (esextractor, &pkt) < ESE_RESULT_EOS
+      && pkt->pts == times[i];
+    if (same)
+      es_extractor_clear_packet (pkt);
+    // The key frame precedes the packet.
+    same = same && es_extractor_seek_time (esextractor, times[i] + 1, ESE_SEEK_FLAG_KEYFRAME) && es_extractor_read_packet (esextractor, &pkt) < ESE_RESULT_EOS
+      && pkt->pts <= times[i];
+    if (same) {
+      size_t number = static_cast<size_t> (std::find (times.begin (), times.end (), pkt->pts) - times.begin ());
+      same          = number < times.size () && keyframes[number];
+      found.insert (pkt->pts);
+      es_extractor_clear_packet (pkt);
+    }
+  }
+  int keyframe_count = same ? static_cast<int> (found.size ()) : -1;
+  INFO ("Found %d key frame(s) by seeking to %zd time(s)", keyframe_count, times.size ());
+  es_extractor_teardown (esextractor);
+  return keyframe_count;
+}
+
+/// @brief Builds the index before reading the packets, then compares it to
+/// the one recorded by another extractor while reading them in order.
+/// @return the packet count, or -1 if the indexes differ.
+int
+compare_index (const char *fileName, const char *options, uint8_t debug_level)
+{
+  ESEResult           res;
+  ESEPacket          *pkt;
+  ESEPacketDescriptor desc, recorded;
+  bool                same = true;
+
+  ESExtractor *esextractor = create_es_extractor (fileName, options, debug_level);
+  if (!esextractor)
+    return -1;
+  ESExtractor *reference = create_es_extractor (fileName, options, debug_level);
+  if (!reference) {
+    es_extractor_teardown (esextractor);
+    return -1;
+  }
+  int64_t packet_count = es_extractor_build_index (esextractor);
+  // The next packet read is still the first one.
+  same &= packet_count > 0 && parse (reference) == packet_count;
+  for (int64_t i = 0; same && i < packet_count; i++) {
+    same = es_extractor_packet_descriptor (esextractor, i, &desc) && es_extractor_packet_descriptor (reference, i, &recorded)
+      && !memcmp (&desc, &recorded, sizeof (desc));
+  }
+  int read_count = 0;
+  while (same && (res = es_extractor_read_packet (esextractor, &pkt)) < ESE_RESULT_EOS) {
+    es_extractor_clear_packet (pkt);
+    read_count++;
+  }
+  if (!same || read_count != packet_count) {
+    ERR ("The index built differs from the one read");
+    packet_count = -1;
+  }
+  INFO ("Built the index of %" PRId64 " packet(s)", packet_count);
+  es_extractor_teardown (reference);
+  es_extractor_teardown (esextractor);
+  return static_cast<int> (packet_count);
+}
+
+/// @brief Reads the packet descriptors with the "packet-data:none" option and
+/// fetches their payloads, which are compared to the packets read in order.
+/// The stream is lent by blocks of block_size bytes if block_size is not 0.
+/// @return the packet count, or -1 if a payload differs.
+int
+parse_descriptors (const char *fileName, const char *options, size_t block_size, uint8_t debug_level)
+{
+  ESEResult                        res;
+  ESEPacket                       *pkt;
+  ESEPacketDescriptor              desc, recorded;
+  std::vector<ESEBuffer>           packets;
+  std::vector<ESEPacketDescriptor> descriptors;
+  ESEBuffer                        payload;
+  std::string                      noneOptions = std::string (options ? options : "") + "\npacket-data:none";
+  bool                             same        = true;
+
+  ESExtractor *reference = create_es_extractor (fileName, options, debug_level);
+  if (!reference)
+    return -1;
+  while ((res = es_extractor_read_packet (reference, &pkt)) < ESE_RESULT_EOS) {
+    packets.push_back (ESEBuffer (pkt->data, pkt->data + pkt->data_size));
+    es_extractor_clear_packet (pkt);
+  }
+
+  BorrowProvider provider;
+  ESExtractor   *esextractor;
+  if (block_size) {
+    std::ifstream file (fileName, std::ios::binary);
+    provider.data.assign (std::istreambuf_iterator<char> (file), std::istreambuf_iterator<char> ());
+    provider.blockSize = block_size;
+    provider.borrowed  = 0;
+    esextractor        = es_extractor_new_with_borrow_func (&BorrowBufferFunc, &ReleaseBufferFunc, &provider, noneOptions.c_str ());
+  } else {
+    esextractor = create_es_extractor (fileName, noneOptions.c_str (), debug_level);
+  }
+  if (!esextractor) {
+    es_extractor_teardown (reference);
+    return -1;
+  }
+  while (same && (res = es_extractor_read_packet_descriptor (esextractor, &desc)) < ESE_RESULT_EOS) {
+    size_t number = descriptors.size ();
+    same          = number < packets.size () && es_extractor_packet_descriptor (reference, static_cast<int64_t> (number), &recorded)
+      && !memcmp (&desc, &recorded, sizeof (desc));
+    descriptors.push_back (desc);
+  }
+  // The payloads are fetched once the stream is read, in the reverse order.
+  for (size_t i = descriptors.size (); same && i-- > 0;) {
+    const ESEBuffer &packet = packets[i];
+    payload.resize (static_cast<size_t> (descriptors[i].size));
+    same = es_extractor_fetch_payload (esextractor, &descriptors[i], payload.data ()) && payload.size () <= packet.size ()
+      && std::equal (payload.begin (), payload.end (), packet.end () - static_cast<std::ptrdiff_t> (payload.size ()));
+  }
+  int packet_count = static_cast<int> (descriptors.size ());
+  if (!same || descriptors.size () != packets.size ()) {
+    ERR ("The payload of the packet %d differs", packet_count - 1);
+    packet_count = -1;
+  }
+  INFO ("Got %d packet descriptor(s)", packet_count);
+  es_extractor_teardown (esextractor);
+  es_extractor_teardown (reference);
+  return packet_count;
+}
+
+/// @brief Writes a VP9 IVF file of frame_count frames of frame_size bytes, the
+/// last one being truncated by truncated_size bytes.
+bool
+write_ivf_file (const char *fileName, int frame_count, size_t frame_size, size_t truncated_size)
+{
+  IVFHeader      header;
+  IVFFrameHeader frame_header;
+  ESEBuffer      frame (frame_size);
+
+  std::memset (&header, 0, sizeof (header));
+  header.signature     = ESE_MAKE_FOURCC ('D', 'K', 'I', 'F');
+  header.length_header = sizeof (IVFHeader);
+  header.fourcc        = ESE_MAKE_FOURCC ('V', 'P', '9', '0');
+  header.frame_count   = static_cast<uint32_t> (frame_count);
+  std::ofstream file (fileName, std::ios::binary);
+  file.write (reinterpret_cast<const char *> (&header), sizeof (header));
+  for (int i = 0; i < frame_count; i++) {
+    frame_header.frame_size = static_cast<uint32_t> (frame_size);
+    frame_header.timestamp  = static_cast<uint64_t> (i);
+    // frame_marker (2), profile 0, show_existing_frame, then frame_type, a
+    // key frame every 8 frames.
+    frame[0] = i % 8 ? 0x84 : 0x80;
+    for (size_t j = 1; j < frame_size; j++)
+      frame[j] = static_cast<uint8_t> (i + j);
+    file.write (reinterpret_cast<const char *> (&frame_header), sizeof (frame_header));
+    size_t size = i == frame_count - 1 ? frame_size - truncated_size : frame_size;
+    file.write (reinterpret_cast<const char *> (frame.data ()), static_cast<std::streamsize> (size));
+  }
+  return file.good ();
+}
+
+/// @brief Returns true if the packet is an SPS, a PPS or a VPS NAL.
+static bool
+is_parameter_set (ESEVideoCodec codec, const ESEBuffer &packet)
+{
+  if (packet.size () < 5)
+    return false;
+  uint8_t header = packet[packet[2] == 0x01 ? 3 : 4];
+  if (codec == ESE_VIDEO_CODEC_H264)
+    return (header & 0x1F) == 7 || (header & 0x1F) == 8;
+  return codec == ESE_VIDEO_CODEC_H265 && ((header >> 1) & 0x3F) >= 32 && ((header >> 1) & 0x3F) <= 34;
+}
+
+/// @brief Reads the key frames with the "filter:keyframes" option, after
+/// building the index if index is set, and compares them to the packets read
+/// without filter.
+/// @return the number of packets read, or -1 if a packet differs.
+int
+parse_keyframes (const char *fileName, const char *options, bool index, uint8_t debug_level)
+{
+  ESEResult              res;
+  ESEPacket             *pkt;
+  ESEPacketDescriptor    desc;
+  std::vector<ESEBuffer> packets;
+  std::string            filterOptions = std::string (options ? options : "") + "\nfilter:keyframes";
+  int                    packet_count  = 0;
+  int                    last          = -1;
+  bool                   same          = true;
+
+  ESExtractor *reference = create_es_extractor (fileName, options, debug_level);
+  if (!reference)
+    return -1;
+  while ((res = es_extractor_read_packet (reference, &pkt)) < ESE_RESULT_EOS) {
+    packets.push_back (ESEBuffer (pkt->data, pkt->data + pkt->data_size));
+    es_extractor_clear_packet (pkt);
+  }
+
+  ESExtractor *esextractor = create_es_extractor (fileName, filterOptions.c_str (), debug_level);
+  if (!esextractor) {
+    es_extractor_teardown (reference);
+    return -1;
+  }
+  if (index)
+    same = es_extractor_build_index (esextractor) == static_cast<int64_t> (packets.size ());
+  // The key frames are returned in order, the other packets only hold parameter sets.
+  while (same && (res = es_extractor_read_packet (esextractor, &pkt)) < ESE_RESULT_EOS) {
+    int number = pkt->packet_number;
+    same       = number > last && static_cast<size_t> (number) < packets.size ()
+      && ESEBuffer (pkt->data, pkt->data + pkt->data_size) == packets[static_cast<size_t> (number)]
+      && es_extractor_packet_descriptor (reference, number, &desc)
+      && ((desc.flags & ESE_PACKET_FLAG_KEYFRAME) || is_parameter_set (es_extractor_video_codec (esextractor), packets[static_cast<size_t> (number)]));
+    last = number;
+    es_extractor_clear_packet (pkt);
+    packet_count++;
+  }
+  if (!same) {
+    ERR ("The key frame %d differs", last);
+    packet_count = -1;
+  }
+  INFO ("Got %d key frame packet(s) out of %zd", packet_count, packets.size ());
+  es_extractor_teardown (esextractor);
+  es_extractor_teardown (reference);
+  return packet_count;
+}
+
+/// @brief Writes an H.265 stream whose pictures hold a prefix SEI, the
+/// slices of the base layer, a slice of layer 1 and filler data, preceded by
+/// an AUD if aud is set. The temporal id of the slices cycles from 0 to 2 and
+/// the even pictures are not referenced.
+bool
+write_nal_file (const char *fileName, int picture_count, int slice_count, bool aud)
+{
+  std::ofstream file (fileName, std::ios::binary);
+  int           nal_number = 0;
+
+  auto write_nal = [&] (int type, int layer, int temporal_id, bool first_slice) {
+    static const uint8_t start_code[] = { 0x00, 0x00, 0x00, 0x01 };
+    ESEBuffer            nal (static_cast<size_t> (32 + nal_number % 16));
+    nal[0] = static_cast<uint8_t> (type << 1 | layer >> 5);
+    nal[1] = static_cast<uint8_t> ((layer & 0x1F) << 3 | (temporal_id + 1));
+    // The payload bytes are odd, so they never emulate a start code.
+    for (size_t j = 2; j < nal.size (); j++)
+      nal[j] = static_cast<uint8_t> ((nal_number + j) << 1 | 1);
+    // first_slice_segment_in_pic_flag
+    nal[2] = static_cast<uint8_t> (first_slice ? nal[2] | 0x80 : nal[2] & 0x7F);
+    file.write (reinterpret_cast<const char *> (start_code), sizeof (start_code));
+    file.write (reinterpret_cast<const char *> (nal.data ()), static_cast<std::streamsize> (nal.size ()));
+    nal_number++;
+  };
+
+  if (aud)
+    write_nal (35, 0, 0, false);
+  write_nal (32, 0, 0, false);
+  write_nal (33, 0, 0, false);
+  write_nal (34, 0, 0, false);
+  for (int j = 0; j < slice_count; j++)
+    write_nal (19, 0, 0, !j);
+  for (int i = 1; i < picture_count; i++) {
+    if (aud)
+      write_nal (35, 0, 0, false);
+    write_nal (39, 0, 0, false);
+    for (int j = 0; j < slice_count; j++)
+      write_nal (i % 2 ? 1 : 0, 0, i % 3, !j);
+    write_nal (1, 1, i % 3, true);
+    write_nal (38, 0, 0, false);
+  }
+  return file.good ();
+}
+
+/// @brief Reads the packets with the NALs dropped by dropOptions, checking
+/// that with NAL alignment they are the packets read without them, in order.
+/// Returns the packet count or -1.
+int
+parse_dropped (const char *fileName, const char *options, const char *dropOptions, uint8_t debug_level)
+{
+  ESEResult              res;
+  ESEPacket             *pkt;
+  std::vector<ESEBuffer> packets;
+  std::string            dropped      = std::string (options ? options : "") + "\n" + dropOptions;
+  bool                   nal          = !options || !strstr (options, "alignment:AU");
+  size_t                 next         = 0;
+  int                    packet_count = 0;
+  bool                   same         = true;
+
+  ESExtractor *reference = create_es_extractor (fileName, options, debug_level);
+  if (!reference)
+    return -1;
+  while ((res = es_extractor_read_packet (reference, &pkt)) < ESE_RESULT_EOS) {
+    packets.push_back (ESEBuffer (pkt->data, pkt->data + pkt->data_size));
+    es_extractor_clear_packet (pkt);
+  }
+
+  ESExtractor *esextractor = create_es_extractor (fileName, dropped.c_str (), debug_level);
+  if (!esextractor) {
+    es_extractor_teardown (reference);
+    return -1;
+  }
+  while (same && (res = es_extractor_read_packet (esextractor, &pkt)) < ESE_RESULT_EOS) {
+    if (nal) {
+      ESEBuffer packet (pkt->data, pkt->data + pkt->data_size);
+      while (next < packets.size () && packets[next] != packet)
+        next++;
+      same = next++ < packets.size ();
+    }
+    es_extractor_clear_packet (pkt);
+    packet_count++;
+  }
+  if (!same) {
+    ERR ("The packet %d is not in the stream", packet_count - 1);
+    packet_count = -1;
+  }
+  INFO ("Got %d packet(s) out of %zd with %s", packet_count, packets.size (), dropOptions);
+  es_extractor_teardown (esextractor);
+  es_extractor_teardown (reference);
+  return packet_count;
+}
+
+/// @brief Reads the stream info before the packets, which are then all read.
+/// Returns the packet count or -1 if the stream is not described.
+int
+read_stream_info (const char *fileName, const char *options, ESEStreamInfo *info, uint8_t debug_level)
+{
+  ESExtractor *esextractor = create_es_extractor (fileName, options, debug_level);
+  if (!esextractor)
+    return -1;
+  if (!es_extractor_stream_info (esextractor, info)) {
+    es_extractor_teardown (esextractor);
+    return -1;
+  }
+  INFO ("Got a stream of %ux%u, profile %u level %u, chroma format %u, bit depth %u/%u, tick %u/%u", info->width, info->height,
+    info->profile, info->level, info->chroma_format, info->bit_depth_luma, info->bit_depth_chroma, info->num_units_in_tick, info->time_scale);
+  int packet_count = parse (esextractor);
+  es_extractor_teardown (esextractor);
+  return packet_count;
+}
+
+/// @brief Writes bits into a NAL payload, inserting the emulation prevention bytes.
+class BitWriter {
+  public:
+  void writeBits (uint32_t value, unsigned count)
+  {
+    while (count--)
+      m_bits.push_back ((value >> count) & 1);
+  }
+  void writeUE (uint32_t value)
+  {
+    unsigned count = 0;
+    while ((static_cast<uint64_t> (value) + 1) >> (count + 1))
+      count++;
+    writeBits (0, count);
+    writeBits (value + 1, count + 1);
+  }
+  ESEBuffer nal (uint8_t header)
+  {
+    ESEBuffer nal = { 0x00, 0x00, 0x00, 0x01, header };
+    int       zeros = 0;
+    // rbsp_stop_one_bit and the alignment bits.
+    writeBits (1, 1);
+    while (m_bits.size () % 8)
+      writeBits (0, 1);
+    for (size_t i = 0; i < m_bits.size (); i += 8) {
+      uint8_t byte = 0;
+      for (size_t j = 0; j < 8; j++)
+        byte = static_cast<uint8_t> (byte << 1 | m_bits[i + j]);
+      if (zeros >= 2 && byte <= 0x03) {
+        nal.push_back (0x03);
+        zeros = 0;
+      }
+      nal.push_back (byte);
+      zeros = byte ? 0 : zeros + 1;
+    }
+    m_bits.clear ();
+    return nal;
+  }
+
+  private:
+  std::vector<bool> m_bits;
+};
+
+/// @brief Returns an H.264 SPS with a cropping window and a VUI timing,
+/// followed by the start of its PPS.
+static ESEBuffer
+h264_parameter_sets (uint32_t width, uint32_t height, uint32_t num_units_in_tick, uint32_t time_scale)
+{
+  BitWriter writer;
+  ESEBuffer nal;
+  uint32_t  width_in_mbs  = (width + 15) / 16;
+  uint32_t  height_in_mbs = (height + 15) / 16;
+
+  // profile_idc 66, the constraint flags, level_idc 40 and the SPS id 0.
+  writer.writeBits (66, 8);
+  writer.writeBits (0, 8);
+  writer.writeBits (40, 8);
+  writer.writeUE (0);
+  // log2_max_frame_num_minus4, pic_order_cnt_type 2, max_num_ref_frames and
+  // gaps_in_frame_num_value_allowed_flag.
+  writer.writeUE (0);
+  writer.writeUE (2);
+  writer.writeUE (1);
+  writer.writeBits (0, 1);
+  writer.writeUE (width_in_mbs - 1);
+  writer.writeUE (height_in_mbs - 1);
+  // frame_mbs_only_flag and direct_8x8_inference_flag
+  writer.writeBits (3, 2);
+  // The cropping window, in 4:2:0 chroma samples.
+  writer.writeBits (1, 1);
+  writer.writeUE (0);
+  writer.writeUE ((width_in_mbs * 16 - width) / 2);
+  writer.writeUE (0);
+  writer.writeUE ((height_in_mbs * 16 - height) / 2);
+  // The VUI holds the timing only, followed by fixed_frame_rate_flag and
+  // the absent HRD and restrictions.
+  writer.writeBits (1, 1);
+  writer.writeBits (0, 4);
+  writer.writeBits (1, 1);
+  writer.writeBits (num_units_in_tick, 32);
+  writer.writeBits (time_scale, 32);
+  writer.writeBits (1, 1);
+  writer.writeBits (0, 5);
+  nal = writer.nal (0x67);
+  // The start of the PPS 0 of the SPS 0, with CAVLC and one slice group.
+  writer.writeUE (0);
+  writer.writeUE (0);
+  writer.writeBits (0, 2);
+  writer.writeUE (0);
+  ESEBuffer pps = writer.nal (0x68);
+  nal.insert (nal.end (), pps.begin (), pps.end ());
+  return nal;
+}
+
+/// @brief Returns the start of an H.264 slice of the frame frame_num, an I
+/// slice of an IDR picture when frame_num is 0 or a P slice otherwise.
+static ESEBuffer
+h264_slice (uint32_t first_mb_in_slice, uint32_t frame_num)
+{
+  BitWriter writer;
+
+  // first_mb_in_slice, slice_type, pic_parameter_set_id, frame_num and
+  // idr_pic_id.
+  writer.writeUE (first_mb_in_slice);
+  writer.writeUE (frame_num ? 5 : 7);
+  writer.writeUE (0);
+  writer.writeBits (frame_num, 4);
+  if (!frame_num)
+    writer.writeUE (0);
+  writer.writeBits (0x55, 8);
+  return writer.nal (frame_num ? 0x41 : 0x65);
+}
+
+/// @brief Writes an H.264 stream of one IDR picture whose SPS holds a
+/// cropping window and a VUI timing with emulation prevention bytes.
+bool
+write_h264_sps_file (const char *fileName, uint32_t width, uint32_t height, uint32_t num_units_in_tick, uint32_t time_scale)
+{
+  std::ofstream file (fileName, std::ios::binary);
+  ESEBuffer     nal = h264_parameter_sets (width, height, num_units_in_tick, time_scale);
+
+  file.write (reinterpret_cast<const char *> (nal.data ()), static_cast<std::streamsize> (nal.size ()));
+  nal = h264_slice (0, 0);
+  file.write (reinterpret_cast<const char *> (nal.data ()), static_cast<std::streamsize> (nal.size ()));
+  return file.good ();
+}
+
+/// @brief Writes an H.264 stream without AUD whose pictures hold slice_count
+/// slices. The slices of every third picture are in the reverse order, its
+/// first slice not starting with the first macroblock.
+bool
+write_h264_slices_file (const char *fileName, int picture_count, int slice_count)
+{
+  std::ofstream file (fileName, std::ios::binary);
+  ESEBuffer     nal = h264_parameter_sets (320, 240, 1, 50);
+  // The 300 macroblocks are split between the slices.
+  uint32_t      slice_mbs = static_cast<uint32_t> (300 / slice_count);
+
+  file.write (reinterpret_cast<const char *> (nal.data ()), static_cast<std::streamsize> (nal.size ()));
+  for (int i = 0; i < picture_count; i++) {
+    for (int j = 0; j < slice_count; j++) {
+      uint32_t slice = static_cast<uint32_t> (i % 3 == 2 ? slice_count - 1 - j : j);
+      nal            = h264_slice (slice * slice_mbs, static_cast<uint32_t> (i % 16));
+      file.write (reinterpret_cast<const char *> (nal.data ()), static_cast<std::streamsize> (nal.size ()));
+    }
+  }
+  return file.good ();
+}
+
+/// @brief Checks the Exp-Golomb values and the emulation prevention bytes
+/// skipped by the bit reader.
+bool
+check_bit_reader ()
+{
+  // ue 0, ue 1, se -1, ue 3 and se -2, then 0x00 0x00 0x00 0x01 with its
+  // emulation prevention byte and a 16-bit value.
+  static const uint8_t data[] = { 0xA6, 0x42, 0x80, 0x00, 0x00, 0x03, 0x00, 0x01, 0x12, 0x34 };
+  ESEBitReader         reader (ESEBufferView (data, sizeof (data)));
+
+  if (reader.readUE () != 0 || reader.readUE () != 1 || reader.readSE () != -1 || reader.readUE () != 3 || reader.readSE () != -2)
+    return false;
+  reader.skipBits (7);
+  if (reader.readBits (16) != 0 || reader.readBits (8) != 0 || reader.readBits (8) != 0x01 || reader.readBits (16) != 0x1234)
+    return false;
+  if (!reader.isValid () || reader.readFlag () || reader.isValid ())
+    return false;
+  return true;
+}
@@ -27,4 +27,60 @@ parse (ESExtractor *extractor);
 int
 parse_file (const char *fileName, const char *options, uint8_t debug_level);
 int
-parse_data (const char *fileName, const char *options, uint8_t debug_level);
\ No newline at end of file
+parse_data (const char *fileName, const char *options, uint8_t debug_level);
+int
+parse_data64 (const char *fileName, const char *options, uint8_t debug_level);
+int
+parse_borrow (const char *fileName, const char *options, size_t block_size, uint8_t debug_level);
+int
+parse_push (const char *fileName, const char *options, size_t chunk_size, uint8_t debug_level);
+int
+parse_push_options (const char *fileName, int repeat, int read_count, const char *options, uint8_t debug_level);
+int
+parse_borrowed_packets (const char *fileName, uint8_t debug_level);
+int
+parse_into (const char *fileName, const char *options, size_t capacity, uint8_t debug_level);
+int
+parse_slices (const char *fileName, const char *options, size_t *slice_total, uint8_t debug_level);
+int
+parse_batches (const char *fileName, const char *options, size_t max, uint8_t debug_level);
+int
+parse_with_allocator (const char *fileName, const char *options, int fail_at, uint8_t debug_level);
+bool
+library_allocations_counted ();
+int
+count_allocations (const char *fileName, const char *options, size_t skip, int repeat, int warmup, bool into, int *packet_count);
+int
+parse_index (const char *fileName, const char *options, int *keyframe_count, uint8_t debug_level);
+int
+save_index (const char *fileName, const char *options, const char *indexName, uint8_t debug_level);
+bool
+copy_file_with_time (const char *fileName, const char *copyName, int64_t seconds, long nanoseconds);
+bool
+corrupt_index_count (const char *indexName, uint64_t added);
+int
+indexed_packets (const char *fileName, const char *options, uint8_t debug_level);
+int
+parse_seek (const char *fileName, const char *options, uint8_t debug_level);
+int
+parse_seek_time (const char *fileName, const char *options, uint8_t debug_level);
+int
+compare_index (const char *fileName, const char *options, uint8_t debug_level);
+int
+parse_descriptors (const char *fileName, const char *options, size_t block_size, uint8_t debug_level);
+bool
+write_ivf_file (const char *fileName, int frame_count, size_t frame_size, size_t truncated_size);
+int
+parse_keyframes (const char *fileName, const char *options, bool index, uint8_t debug_level);
+bool
+write_nal_file (const char *fileName, int picture_count, int slice_count, bool aud);
+int
+parse_dropped (const char *fileName, const char *options, const char *dropOptions, uint8_t debug_level);
+int
+read_stream_info (const char *fileName, const char *options, ESEStreamInfo *info, uint8_t debug_level);
+bool
+write_h264_sps_file (const char *fileName, uint32_t width, uint32_t height, uint32_t num_units_in_tick, uint32_t time_scale);
+bool
+write_h264_slices_file (const char *fileName, int picture_count, int slice_count);
+bool
+check_bit_reader ();
@@ -16,6 +16,7 @@
  */
 
 #include <cassert>
+#include <cstdio>
 #include <string>
 
 #include "config.h"
@@ -76,6 +77,7 @@ main ()
   // NAL tests
   check_nal_file (ESE_SAMPLES_FOLDER "/Sample_10.avc", log_level, ESE_VIDEO_CODEC_H264, "h264", 22, 10);
   check_nal_file (ESE_SAMPLES_FOLDER "/Sample_10.hevc", log_level, ESE_VIDEO_CODEC_H265, "h265", 23, 10);
+  check_nal_file (ESE_SAMPLES_FOLDER "/clip-a.h264", log_level, ESE_VIDEO_CODEC_H264, "h264", 37, 30);
   // IVF tests
   check_ivf_file (ESE_SAMPLES_FOLDER "/clip-a.ivf", log_level, ESE_VIDEO_CODEC_AV1, "av1", 30);
 
@@ -83,6 +85,245 @@ main ()
   assert (parse_data (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, log_level) == 22);
   assert (parse_data (ESE_SAMPLES_FOLDER "/Sample_10.hevc", nullptr, log_level) == 23);
   assert (parse_data (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, log_level) == 30);
+  assert (parse_data64 (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, log_level) == 22);
+  assert (parse_data64 (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, log_level) == 30);
+
+  // Read-ahead tests
+  assert (parse_file (ESE_SAMPLES_FOLDER "/Sample_10.avc", "readahead:4", log_level) == 22);
+  assert (parse_file (ESE_SAMPLES_FOLDER "/clip-a.ivf", "readahead:2", log_level) == 30);
+  assert (parse_data (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "readahead:1", log_level) == 23);
+
+  // Reader selection tests
+  assert (parse_file (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "reader:file", log_level) == 23);
+  assert (parse_file (ESE_SAMPLES_FOLDER "/Sample_10.avc", "reader:uring", log_level) == 22);
+  assert (parse_file (ESE_SAMPLES_FOLDER "/clip-a.ivf", "reader:uring", log_level) == 30);
+
+  // Borrow tests
+  assert (parse_borrow (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, 1000, log_level) == 22);
+  assert (parse_borrow (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "alignment:AU", 64 * 1024, log_level) == 10);
+  assert (parse_borrow (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, 7, log_level) == 30);
+
+  // Push tests
+  assert (parse_push (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, 1, log_level) == 22);
+  assert (parse_push (ESE_SAMPLES_FOLDER "/Sample_10.avc", "alignment:AU", 100, log_level) == 10);
+  assert (parse_push (ESE_SAMPLES_FOLDER "/Sample_10.hevc", nullptr, 4096, log_level) == 23);
+  assert (parse_push (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, 7, log_level) == 30);
+  assert (parse_push (ESE_SAMPLES_FOLDER "/clip.obu", "format:annex-b", 1000, log_level) == 20);
+  // The options are kept once the start of the pushed stream is released.
+  assert (parse_push_options (ESE_SAMPLES_FOLDER "/Sample_10.avc", 20, 400, "alignment:AU", log_level) == 440);
+
+  // Packet pool tests: the packets are recycled once the buffers have grown.
+  // The allocations are only counted when the library uses the replaced
+  // operator new.
+  int packet_count;
+  if (library_allocations_counted ()) {
+    assert (count_allocations (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, 0, 10, 44, false, &packet_count) == 0);
+    assert (packet_count == 176);
+    assert (count_allocations (ESE_SAMPLES_FOLDER "/Sample_10.hevc", nullptr, 0, 10, 46, false, &packet_count) == 0);
+    assert (count_allocations (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, 32, 10, 60, false, &packet_count) == 0);
+    assert (packet_count == 240);
+    // Access units are classified and assembled without allocations.
+    assert (count_allocations (ESE_SAMPLES_FOLDER "/Sample_10.avc", "alignment:AU", 0, 10, 20, false, &packet_count) == 0);
+    assert (count_allocations (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "alignment:AU", 0, 10, 20, false, &packet_count) == 0);
+    // Without recycling, each packet is allocated.
+    assert (count_allocations (ESE_SAMPLES_FOLDER "/Sample_10.avc", "packet-pool-size:0", 0, 10, 44, false, &packet_count) == packet_count);
+    // Unless written to the application buffer.
+    assert (count_allocations (ESE_SAMPLES_FOLDER "/Sample_10.avc", "packet-pool-size:0", 0, 10, 44, true, &packet_count) == 0);
+    assert (count_allocations (ESE_SAMPLES_FOLDER "/clip-a.ivf", "packet-pool-size:0", 32, 10, 60, true, &packet_count) == 0);
+  }
+
+  // Borrowed packet tests
+  assert (parse_borrowed_packets (ESE_SAMPLES_FOLDER "/Sample_10.avc", log_level) == 22);
+  assert (parse_borrowed_packets (ESE_SAMPLES_FOLDER "/Sample_10.hevc", log_level) == 23);
+  assert (parse_borrowed_packets (ESE_SAMPLES_FOLDER "/clip-a.h264", log_level) == 37);
+  assert (parse_file (ESE_SAMPLES_FOLDER "/Sample_10.avc", "packet-data:borrow\nalignment:AU", log_level) == 10);
+  assert (parse_data (ESE_SAMPLES_FOLDER "/Sample_10.avc", "packet-data:borrow", log_level) == 22);
+
+  // Read into tests
+  assert (parse_into (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, 0, log_level) == 22);
+  assert (parse_into (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "alignment:AU", 1024 * 1024, log_level) == 10);
+  assert (parse_into (ESE_SAMPLES_FOLDER "/Sample_10.avc", "packet-data:borrow", 16, log_level) == 22);
+  assert (parse_into (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, 16, log_level) == 30);
+  assert (parse_into (ESE_SAMPLES_FOLDER "/clip.obu", "format:annex-b", 16, log_level) == 20);
+
+  // Slice tests: an access unit is made of its AUD and of its NALs.
+  size_t slice_total;
+  assert (parse_slices (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, &slice_total, log_level) == 22);
+  assert (slice_total == 22);
+  assert (parse_slices (ESE_SAMPLES_FOLDER "/Sample_10.avc", "alignment:AU", &slice_total, log_level) == 10);
+  assert (slice_total == 22);
+  assert (parse_slices (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "alignment:AU\npacket-data:borrow", &slice_total, log_level) == 10);
+  assert (parse_slices (ESE_SAMPLES_FOLDER "/clip-a.h264", "alignment:AU\npacket-data:borrow", &slice_total, log_level) == 30);
+  assert (parse_slices (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, &slice_total, log_level) == 30);
+
+  // Allocator tests
+  assert (parse_with_allocator (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, -1, log_level) == 22);
+  assert (parse_with_allocator (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "alignment:AU", -1, log_level) == 10);
+  assert (parse_with_allocator (ESE_SAMPLES_FOLDER "/clip-a.ivf", "packet-pool-size:0", -1, log_level) == 30);
+  assert (parse_with_allocator (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, 1, log_level) == 30);
+
+  // Batch tests
+  assert (parse_batches (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, 1, log_level) == 22);
+  assert (parse_batches (ESE_SAMPLES_FOLDER "/Sample_10.avc", "packet-data:borrow", 4, log_level) == 22);
+  assert (parse_batches (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "alignment:AU", 3, log_level) == 10);
+  assert (parse_batches (ESE_SAMPLES_FOLDER "/clip-a.h264", "alignment:AU", 30, log_level) == 30);
+  assert (parse_batches (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, 64, log_level) == 30);
+  assert (parse_batches (ESE_SAMPLES_FOLDER "/clip.obu", "format:annex-b", 7, log_level) == 20);
+
+  // Index tests
+  int keyframe_count;
+  assert (parse_index (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, &keyframe_count, log_level) == 22);
+  assert (keyframe_count == 1);
+  assert (parse_index (ESE_SAMPLES_FOLDER "/Sample_10.avc", "alignment:AU\npacket-data:borrow", &keyframe_count, log_level) == 10);
+  assert (keyframe_count == 1);
+  assert (parse_index (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "alignment:AU", &keyframe_count, log_level) == 10);
+  assert (keyframe_count == 1);
+  assert (parse_index (ESE_SAMPLES_FOLDER "/clip-a.h264", nullptr, &keyframe_count, log_level) == 37);
+  assert (keyframe_count == 3);
+  assert (parse_index (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, &keyframe_count, log_level) == 30);
+  assert (keyframe_count == 1);
+  assert (parse_index (ESE_SAMPLES_FOLDER "/clip-a.ivf", "reader:file", &keyframe_count, log_level) == 30);
+  assert (parse_index (ESE_SAMPLES_FOLDER "/clip.obu", "format:annex-b", &keyframe_count, log_level) == 20);
+  assert (keyframe_count == 3);
+  assert (save_index (ESE_SAMPLES_FOLDER "/Sample_10.avc", "alignment:AU", "Sample_10.avc.eseidx", log_level) == 10);
+  assert (save_index (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, "clip-a.ivf.eseidx", log_level) == 30);
+  assert (indexed_packets (ESE_SAMPLES_FOLDER "/Sample_10.avc", "alignment:AU\nindex:Sample_10.avc.eseidx", log_level) == 10);
+  // The index of another stream or alignment is ignored.
+  assert (indexed_packets (ESE_SAMPLES_FOLDER "/Sample_10.avc", "index:Sample_10.avc.eseidx", log_level) == 1);
+  assert (indexed_packets (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "alignment:AU\nindex:Sample_10.avc.eseidx", log_level) == 1);
+  assert (indexed_packets (ESE_SAMPLES_FOLDER "/clip-a.ivf", "index:Sample_10.avc.eseidx", log_level) == 1);
+  std::remove ("Sample_10.avc.eseidx");
+  std::remove ("clip-a.ivf.eseidx");
+  // The index of a file rewritten within the same second is ignored.
+  if (copy_file_with_time (ESE_SAMPLES_FOLDER "/Sample_10.avc", "rewritten.avc", 1700000000, 100000000)) {
+    assert (save_index ("rewritten.avc", "alignment:AU", "rewritten.avc.eseidx", log_level) == 10);
+    assert (copy_file_with_time (ESE_SAMPLES_FOLDER "/Sample_10.avc", "rewritten.avc", 1700000000, 200000000));
+    assert (indexed_packets ("rewritten.avc", "alignment:AU\nindex:rewritten.avc.eseidx", log_level) == 1);
+    std::remove ("rewritten.avc.eseidx");
+  }
+  std::remove ("rewritten.avc");
+  // A sidecar index with an overflowing count is ignored.
+  copy_file_with_time (ESE_SAMPLES_FOLDER "/clip-a.h264", "corrupted.h264", 1700000000, 0);
+  assert (save_index ("corrupted.h264", nullptr, "corrupted.h264.eseidx", log_level) == 37);
+  assert (indexed_packets ("corrupted.h264", nullptr, log_level) == 37);
+  assert (corrupt_index_count ("corrupted.h264.eseidx", static_cast<uint64_t> (1) << 59));
+  assert (indexed_packets ("corrupted.h264", nullptr, log_level) == 1);
+  assert (parse_file ("corrupted.h264", nullptr, log_level) == 37);
+  std::remove ("corrupted.h264.eseidx");
+  std::remove ("corrupted.h264");
+  // The IVF index is built from the frame headers only.
+  assert (compare_index (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, log_level) == 30);
+  assert (compare_index (ESE_SAMPLES_FOLDER "/clip-a.ivf", "reader:file", log_level) == 30);
+  assert (compare_index (ESE_SAMPLES_FOLDER "/clip-a.ivf", "reader:uring", log_level) == 30);
+  assert (compare_index (ESE_SAMPLES_FOLDER "/clip-a.ivf", "readahead:2", log_level) == 30);
+  assert (compare_index (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "alignment:AU", log_level) == 10);
+
+  // Seek tests
+  assert (parse_seek (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, log_level) == 22);
+  assert (parse_seek (ESE_SAMPLES_FOLDER "/Sample_10.avc", "alignment:AU\npacket-data:borrow", log_level) == 10);
+  assert (parse_seek (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "alignment:AU", log_level) == 10);
+  assert (parse_seek (ESE_SAMPLES_FOLDER "/clip-a.h264", "reader:file", log_level) == 37);
+  assert (parse_seek (ESE_SAMPLES_FOLDER "/clip-a.h264", "alignment:AU\nreadahead:4", log_level) == 30);
+  assert (parse_seek (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, log_level) == 30);
+  assert (parse_seek (ESE_SAMPLES_FOLDER "/clip-a.ivf", "reader:file", log_level) == 30);
+  assert (parse_seek (ESE_SAMPLES_FOLDER "/clip.obu", "format:annex-b", log_level) == 20);
+  assert (parse_seek (ESE_SAMPLES_FOLDER "/clip.obu", "format:annex-b\nreader:file", log_level) == 20);
+  assert (parse_seek_time (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, log_level) == 1);
+  assert (parse_seek_time (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, log_level) == -1);
+
+  // Descriptor tests: the payloads are fetched on demand.
+  assert (parse_descriptors (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, 0, log_level) == 22);
+  assert (parse_descriptors (ESE_SAMPLES_FOLDER "/Sample_10.avc", "alignment:AU\nreader:file", 0, log_level) == 10);
+  assert (parse_descriptors (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "alignment:AU", 0, log_level) == 10);
+  assert (parse_descriptors (ESE_SAMPLES_FOLDER "/clip-a.h264", "reader:file", 0, log_level) == 37);
+  assert (parse_descriptors (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, 0, log_level) == 30);
+  assert (parse_descriptors (ESE_SAMPLES_FOLDER "/clip-a.ivf", "reader:file", 0, log_level) == 30);
+  assert (parse_descriptors (ESE_SAMPLES_FOLDER "/clip-a.ivf", "readahead:2", 0, log_level) == 30);
+  assert (parse_descriptors (ESE_SAMPLES_FOLDER "/clip.obu", "format:annex-b", 0, log_level) == 20);
+  // The payloads are borrowed again once the stream reads reached its end.
+  assert (parse_descriptors (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, 1000, log_level) == 22);
+  assert (parse_descriptors (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "alignment:AU", 64 * 1024, log_level) == 10);
+  assert (parse_descriptors (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, 4096, log_level) == 30);
+  // The frames larger than the key frame probe are skipped, up to the end of
+  // the truncated last frame.
+  assert (write_ivf_file ("large-frames.ivf", 40, 5000, 1000));
+  assert (parse_descriptors ("large-frames.ivf", nullptr, 0, log_level) == 40);
+  assert (parse_descriptors ("large-frames.ivf", "reader:file", 0, log_level) == 40);
+  assert (parse_descriptors ("large-frames.ivf", "readahead:2", 0, log_level) == 40);
+  assert (parse_index ("large-frames.ivf", nullptr, &keyframe_count, log_level) == 40);
+  assert (keyframe_count == 5);
+  assert (compare_index ("large-frames.ivf", nullptr, log_level) == 40);
+  std::remove ("large-frames.ivf");
+
+  // Key frame tests: the other packets are skipped, by seeking once indexed.
+  assert (parse_keyframes (ESE_SAMPLES_FOLDER "/Sample_10.avc", "alignment:AU", false, log_level) == 1);
+  assert (parse_keyframes (ESE_SAMPLES_FOLDER "/Sample_10.avc", "alignment:AU", true, log_level) == 1);
+  assert (parse_keyframes (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, false, log_level) == 3);
+  assert (parse_keyframes (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "alignment:AU\npacket-data:borrow", true, log_level) == 1);
+  assert (parse_keyframes (ESE_SAMPLES_FOLDER "/clip-a.h264", "alignment:AU", false, log_level) == 3);
+  assert (parse_keyframes (ESE_SAMPLES_FOLDER "/clip-a.h264", "alignment:AU\nreader:file", true, log_level) == 3);
+  assert (parse_keyframes (ESE_SAMPLES_FOLDER "/clip-a.h264", nullptr, true, log_level) == 9);
+  assert (parse_keyframes (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, false, log_level) == 1);
+  assert (parse_keyframes (ESE_SAMPLES_FOLDER "/clip.obu", "format:annex-b", true, log_level) == 3);
+  assert (write_ivf_file ("keyframes.ivf", 40, 5000, 0));
+  assert (parse_keyframes ("keyframes.ivf", nullptr, false, log_level) == 5);
+  assert (parse_keyframes ("keyframes.ivf", "readahead:2", true, log_level) == 5);
+  std::remove ("keyframes.ivf");
+
+  // NAL filtering tests: the dropped NALs are neither returned nor gathered.
+  assert (write_nal_file ("filter.hevc", 9, 1, true));
+  assert (parse_dropped ("filter.hevc", nullptr, "drop-nals:sei", log_level) == 37);
+  assert (parse_dropped ("filter.hevc", "reader:file", "drop-nals:filler", log_level) == 37);
+  assert (parse_dropped ("filter.hevc", nullptr, "drop-nals:layers", log_level) == 37);
+  assert (parse_dropped ("filter.hevc", "packet-data:borrow", "drop-nals:non-reference", log_level) == 41);
+  assert (parse_dropped ("filter.hevc", nullptr, "max-temporal-id:0", log_level) == 33);
+  assert (parse_dropped ("filter.hevc", nullptr, "drop-nals:sei,filler,layers,non-reference\nmax-temporal-id:1", log_level) == 16);
+  assert (parse_dropped ("filter.hevc", "alignment:AU", "drop-nals:layers", log_level) == 9);
+  assert (parse_dropped ("filter.hevc", "alignment:AU", "drop-nals:filler,layers,non-reference", log_level) == 5);
+  assert (parse_dropped ("filter.hevc", "alignment:AU\npacket-data:borrow", "drop-nals:layers,non-reference", log_level) == 5);
+  assert (parse_dropped ("filter.hevc", "alignment:AU\npacket-data:none", "drop-nals:filler,layers\nmax-temporal-id:0", log_level) == 3);
+  assert (parse_dropped (ESE_SAMPLES_FOLDER "/clip-a.h264", nullptr, "drop-nals:sei", log_level) == 36);
+  std::remove ("filter.hevc");
+
+  // Access unit tests: the pictures of several slices, without AUD, are
+  // found from their slice headers.
+  assert (write_nal_file ("slices.hevc", 6, 3, false));
+  assert (parse_file ("slices.hevc", nullptr, log_level) == 36);
+  assert (parse_file ("slices.hevc", "alignment:AU", log_level) == 6);
+  assert (parse_seek ("slices.hevc", "alignment:AU\npacket-data:borrow", log_level) == 6);
+  assert (parse_dropped ("slices.hevc", "alignment:AU", "drop-nals:layers,non-reference", log_level) == 4);
+  assert (parse_dropped ("slices.hevc", "alignment:AU\npacket-data:none", "max-temporal-id:0", log_level) == 2);
+  std::remove ("slices.hevc");
+  assert (write_h264_slices_file ("slices.h264", 8, 3));
+  assert (parse_file ("slices.h264", nullptr, log_level) == 26);
+  assert (parse_file ("slices.h264", "alignment:AU", log_level) == 8);
+  assert (parse_seek ("slices.h264", "alignment:AU", log_level) == 8);
+  assert (parse_descriptors ("slices.h264", "alignment:AU\nreader:file", 0, log_level) == 8);
+  std::remove ("slices.h264");
+
+  // Stream info tests: the parameter sets are found ahead of the next packet.
+  ESEStreamInfo info;
+  assert (check_bit_reader ());
+  assert (read_stream_info (ESE_SAMPLES_FOLDER "/Sample_10.avc", nullptr, &info, log_level) == 22);
+  assert (info.codec == ESE_VIDEO_CODEC_H264 && info.width == 320 && info.height == 240);
+  assert (info.profile == 100 && info.level == 13 && info.chroma_format == 1 && info.bit_depth_luma == 8);
+  assert (info.num_units_in_tick == 1000 && info.time_scale == 60000);
+  assert (read_stream_info (ESE_SAMPLES_FOLDER "/Sample_10.avc", "alignment:AU\npacket-data:none", &info, log_level) == 10);
+  assert (info.width == 320 && info.height == 240);
+  assert (read_stream_info (ESE_SAMPLES_FOLDER "/Sample_10.hevc", "reader:file", &info, log_level) == 23);
+  assert (info.codec == ESE_VIDEO_CODEC_H265 && info.width == 320 && info.height == 240);
+  assert (info.profile == 1 && info.level == 60 && info.chroma_format == 1 && info.bit_depth_chroma == 8);
+  assert (info.num_units_in_tick == 1 && info.time_scale == 30);
+  assert (read_stream_info (ESE_SAMPLES_FOLDER "/clip-a.h264", "packet-data:borrow", &info, log_level) == 37);
+  assert (info.width == 176 && info.height == 144 && info.level == 11);
+  assert (read_stream_info (ESE_SAMPLES_FOLDER "/clip-a.ivf", nullptr, &info, log_level) == 30);
+  assert (info.codec == ESE_VIDEO_CODEC_AV1 && info.width == 176 && info.height == 144 && info.time_scale == 90000);
+  assert (write_h264_sps_file ("sps.h264", 1920, 1080, 1, 60));
+  assert (read_stream_info ("sps.h264", nullptr, &info, log_level) == 3);
+  assert (info.width == 1920 && info.height == 1080 && info.profile == 66 && info.level == 40);
+  assert (info.chroma_format == 1 && info.bit_depth_luma == 8);
+  assert (info.num_units_in_tick == 1 && info.time_scale == 60);
+  std::remove ("sps.h264");
 
   // Annex B tests
   check_annex_b_file (ESE_SAMPLES_FOLDER "/clip.obu", log_level, ESE_VIDEO_CODEC_AV1, "av1", 20);
@@ -93,6 +334,7 @@ main ()
 
   assert (es_extractor_read_packet (nullptr, nullptr) == ESE_RESULT_ERROR);
   assert (es_extractor_packet_count (nullptr) == -1);
+  assert (es_extractor_packet_count64 (nullptr) == -1);
   assert (es_extractor_video_format (nullptr) == ESE_VIDEO_FORMAT_UNKNOWN);
   assert (es_extractor_video_codec (nullptr) == ESE_VIDEO_CODEC_UNKNOWN);
   assert (es_extractor_video_codec_name (nullptr) == nullptr);